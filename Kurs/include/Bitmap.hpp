@@ -0,0 +1,239 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "Serialize.hpp"
+
+// roaring-style compressed bitmap of 32-bit ids:
+// ids are bucketed by their high 16 bits, each bucket is either a sorted
+// array (sparse) or a 65536-bit bitset (dense)
+class Roaring_bitmap {
+   private:
+    static constexpr uint32_t ARRAY_LIMIT = 4096;  // above this a bitset is smaller than an array
+    static constexpr uint32_t BITSET_WORDS = 65536 / 64;
+
+    struct Container {
+        std::vector<uint16_t> array{};
+        std::unique_ptr<std::array<uint64_t, BITSET_WORDS>> bits{};
+        uint32_t cardinality{};
+
+        Container() = default;
+        Container(Container&&) noexcept = default;
+        Container& operator=(Container&&) noexcept = default;
+        Container(const Container& other)
+            : array{other.array},
+              bits{other.bits ? std::make_unique<std::array<uint64_t, BITSET_WORDS>>(*other.bits) : nullptr},
+              cardinality{other.cardinality} {}
+
+        [[nodiscard]] bool is_bitset() const { return bits != nullptr; }
+
+        [[nodiscard]] bool contains(uint16_t low) const {
+            if (is_bitset())
+                return ((*bits)[low >> 6] >> (low & 63)) & 1;
+            return std::ranges::binary_search(array, low);
+        }
+
+        bool add(uint16_t low) {
+            if (is_bitset()) {
+                auto& word = (*bits)[low >> 6];
+                const uint64_t MASK = uint64_t{1} << (low & 63);
+                if (word & MASK) return false;
+                word |= MASK;
+            } else {
+                auto&& it = std::ranges::lower_bound(array, low);
+                if (it != array.end() && *it == low) return false;
+                array.insert(it, low);
+                if (array.size() > ARRAY_LIMIT) to_bitset();
+            }
+            ++cardinality;
+            return true;
+        }
+
+        bool remove(uint16_t low) {
+            if (is_bitset()) {
+                auto& word = (*bits)[low >> 6];
+                const uint64_t MASK = uint64_t{1} << (low & 63);
+                if (!(word & MASK)) return false;
+                word &= ~MASK;
+                if (--cardinality <= ARRAY_LIMIT) to_array();
+            } else {
+                auto&& it = std::ranges::lower_bound(array, low);
+                if (it == array.end() || *it != low) return false;
+                array.erase(it);
+                --cardinality;
+            }
+            return true;
+        }
+
+        void to_bitset() {
+            bits = std::make_unique<std::array<uint64_t, BITSET_WORDS>>();
+            for (auto low : array)
+                (*bits)[low >> 6] |= uint64_t{1} << (low & 63);
+            array = {};
+        }
+
+        void to_array() {
+            array.clear();
+            array.reserve(cardinality);
+            for_each([this](uint16_t low) { array.push_back(low); });
+            bits.reset();
+        }
+
+        void for_each(auto&& func) const {
+            if (!is_bitset()) {
+                for (auto low : array) func(low);
+                return;
+            }
+            for (uint32_t w = 0; w < BITSET_WORDS; w++) {
+                for (uint64_t word = (*bits)[w]; word != 0; word &= word - 1)
+                    func(uint16_t(w * 64 + std::countr_zero(word)));
+            }
+        }
+
+        // keep_common == true gives intersection, false gives difference (this \ other)
+        [[nodiscard]] static Container combine(const Container& l, const Container& r, bool keep_common) {
+            Container result;
+            if (l.is_bitset() && r.is_bitset()) {
+                result.bits = std::make_unique<std::array<uint64_t, BITSET_WORDS>>();
+                for (uint32_t w = 0; w < BITSET_WORDS; w++) {
+                    const uint64_t WORD = keep_common ? (*l.bits)[w] & (*r.bits)[w] : (*l.bits)[w] & ~(*r.bits)[w];
+                    (*result.bits)[w] = WORD;
+                    result.cardinality += std::popcount(WORD);
+                }
+                if (result.cardinality <= ARRAY_LIMIT) result.to_array();
+                return result;
+            }
+            if (!l.is_bitset() && !r.is_bitset()) {
+                if (keep_common)
+                    std::ranges::set_intersection(l.array, r.array, std::back_inserter(result.array));
+                else
+                    std::ranges::set_difference(l.array, r.array, std::back_inserter(result.array));
+            } else {
+                l.for_each([&](uint16_t low) {
+                    if (r.contains(low) == keep_common) result.array.push_back(low);
+                });
+                if (result.array.size() > ARRAY_LIMIT) {
+                    result.cardinality = uint32_t(result.array.size());
+                    result.to_bitset();
+                    return result;
+                }
+            }
+            result.cardinality = uint32_t(result.array.size());
+            return result;
+        }
+    };
+
+    std::map<uint16_t, Container> containers{};
+
+   public:
+    Roaring_bitmap() = default;
+
+    template <std::ranges::input_range Range>
+    [[nodiscard]] static Roaring_bitmap from(Range&& ids) {
+        Roaring_bitmap result;
+        for (auto&& id : ids) result.add(uint32_t(id));
+        return result;
+    }
+
+    void add(uint32_t id) { containers[uint16_t(id >> 16)].add(uint16_t(id)); }
+
+    void remove(uint32_t id) {
+        if (auto&& it = containers.find(uint16_t(id >> 16)); it != containers.end()) {
+            it->second.remove(uint16_t(id));
+            if (it->second.cardinality == 0) containers.erase(it);
+        }
+    }
+
+    void set(uint32_t id, bool value) { value ? add(id) : remove(id); }
+
+    void clear() { containers.clear(); }
+
+    [[nodiscard]] bool contains(uint32_t id) const {
+        auto&& it = containers.find(uint16_t(id >> 16));
+        return it != containers.end() && it->second.contains(uint16_t(id));
+    }
+
+    [[nodiscard]] size_t cardinality() const {
+        size_t result = 0;
+        for (auto&& [_, c] : containers) result += c.cardinality;
+        return result;
+    }
+
+    [[nodiscard]] bool empty() const { return containers.empty(); }
+
+    // ascending order
+    void for_each(auto&& func) const {
+        for (auto&& [high, c] : containers)
+            c.for_each([&](uint16_t low) { func((uint32_t(high) << 16) | low); });
+    }
+
+    [[nodiscard]] std::vector<uint32_t> to_vector() const {
+        std::vector<uint32_t> result;
+        result.reserve(cardinality());
+        for_each([&result](uint32_t id) { result.push_back(id); });
+        return result;
+    }
+
+    void serialize(Byte_writer& out) const {
+        out.put(uint32_t(containers.size()));
+        for (auto&& [high, c] : containers) {
+            out.put(high).put(c.cardinality).put(uint8_t(c.is_bitset()));
+            if (c.is_bitset())
+                out.put(*c.bits);
+            else
+                for (auto low : c.array) out.put(low);
+        }
+    }
+
+    [[nodiscard]] bool deserialize(Byte_reader& in) {
+        clear();
+        uint32_t n_containers{};
+        in.get(n_containers);
+        for (uint32_t i = 0; i < n_containers && in.ok(); i++) {
+            uint16_t high{};
+            uint8_t is_bitset{};
+            Container c;
+            in.get(high), in.get(c.cardinality), in.get(is_bitset);
+            if (is_bitset) {
+                c.bits = std::make_unique<std::array<uint64_t, BITSET_WORDS>>();
+                in.get(*c.bits);
+            } else {
+                c.array.resize(std::min(c.cardinality, ARRAY_LIMIT));
+                for (auto& low : c.array) in.get(low);
+            }
+            containers.emplace(high, std::move(c));
+        }
+        return in.ok();
+    }
+
+    [[nodiscard]] Roaring_bitmap operator&(const Roaring_bitmap& other) const {
+        Roaring_bitmap result;
+        for (auto&& [high, c] : containers) {
+            if (auto&& it = other.containers.find(high); it != other.containers.end()) {
+                if (auto&& combined = Container::combine(c, it->second, true); combined.cardinality > 0)
+                    result.containers.emplace(high, std::move(combined));
+            }
+        }
+        return result;
+    }
+
+    // ids present here but not in other
+    [[nodiscard]] Roaring_bitmap operator-(const Roaring_bitmap& other) const {
+        Roaring_bitmap result;
+        for (auto&& [high, c] : containers) {
+            auto&& it = other.containers.find(high);
+            if (it == other.containers.end()) {
+                result.containers.emplace(high, c);
+            } else if (auto&& combined = Container::combine(c, it->second, false); combined.cardinality > 0) {
+                result.containers.emplace(high, std::move(combined));
+            }
+        }
+        return result;
+    }
+};
@@ -1,69 +1,317 @@
 #pragma once
+#include <algorithm>
 #include <format>
+#include <future>
+#include <optional>
 #include <ranges>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include "Bitmap.hpp"
 #include "Fsystem.hpp"
+#include "Index.hpp"
+#include "Loans.hpp"
+#include "Row_cache.hpp"
+#include "Serialize.hpp"
 #include "thirdparty/json.hpp"
 
+struct Book_row {
+    std::string title, author, publisher;
+    uint16_t year{}, pages{}, copies{1};
+    bool valid{};
+};
+
 class Book {
    private:
     static inline size_t global_book_id = 1;
     static inline nlohmann::json books_json{};
+    static inline Range_index<uint16_t, size_t> year_idx{}, pages_idx{};
+    static inline Range_index<uint32_t, size_t> borrowed_idx{};
+    static inline Inverted_index title_idx{}, author_idx{}, publisher_idx{};
+    static inline Roaring_bitmap all_books{}, available_books{};
+    static inline std::shared_future<void> indexes_ready{};
+    static inline std::string catalog_file{};
+    static inline bool (*hold_lender)(size_t reader_id, Book& book) = nullptr;
+    static constexpr uint32_t INDEX_FILE_MAGIC = 0x5844494B, INDEX_FILE_FORMAT = 5;  // "KIDX"
+
+    static void index(const nlohmann::json& data) {
+        const auto ID = data.at("ID").get<size_t>();
+        year_idx.update(ID, data.at("Year").get<uint16_t>());
+        pages_idx.update(ID, data.at("Pages").get<uint16_t>());
+        borrowed_idx.update(ID, data.at("Borrowed").get<uint32_t>());
+        title_idx.update(ID, data.at("Title").get_ref<const std::string&>());
+        author_idx.update(ID, data.at("Author").get_ref<const std::string&>());
+        publisher_idx.update(ID, data.at("Publisher").get_ref<const std::string&>());
+        all_books.add(uint32_t(ID));
+        available_books.set(uint32_t(ID), data.at("Available").get<uint16_t>() > 0);
+    }
+
+    static void wait_indexes() {
+        if (indexes_ready.valid()) indexes_ready.wait();
+    }
+
+    [[nodiscard]] static std::string index_file(std::string_view catalog) { return std::format("{}.idx", catalog); }
+
+    static void rebuild_indexes() {
+        year_idx.clear(), pages_idx.clear(), borrowed_idx.clear();
+        title_idx = {}, author_idx = {}, publisher_idx = {}, all_books.clear(), available_books.clear();
+        for (const auto& [_, data] : books_json.items())
+            index(data);
+    }
+
+    static void migrate() {
+        if (books_json.empty())
+            return;
+        // catalogs used to be keyed by title with no "Title" field, re-key them by ID
+        if (!books_json.begin()->contains("Title")) {
+            nlohmann::json by_id = nlohmann::json::object();
+            for (auto&& [title, data] : books_json.items()) {
+                data["Title"] = title;
+                by_id[key_of(data.at("ID").get<size_t>())] = std::move(data);
+            }
+            books_json = std::move(by_id);
+        }
+        if (!books_json.begin()->contains("Borrowed")) {
+            for (auto&& [_, data] : books_json.items())
+                data["Borrowed"] = 0;
+        }
+        // one record per copy with an "In library" flag became copy counters
+        if (!books_json.begin()->contains("Copies")) {
+            for (auto&& [_, data] : books_json.items()) {
+                data["Copies"] = 1;
+                data["Available"] = data.value("In library", true) ? 1 : 0;
+                data.erase("In library");
+            }
+        }
+    }
+
+    // every index is stored as a section stamped with the catalog version it was built from
+    // and a checksum of its payload; any stale or damaged section rejects the whole file
+    [[nodiscard]] static bool load_indexes(std::string_view catalog) {
+        const uint64_t CATALOG_VERSION = FileSystem::version_of(catalog);
+        const std::string BYTES = FileSystem::read_bytes(index_file(catalog));
+        Byte_reader in(BYTES);
+        uint32_t magic{}, format{}, n_sections{};
+        if (!in.get(magic) || !in.get(format) || !in.get(n_sections) ||
+            magic != INDEX_FILE_MAGIC || format != INDEX_FILE_FORMAT)
+            return false;
+
+        std::unordered_map<std::string, std::string_view> sections;
+        for (uint32_t i = 0; i < n_sections; i++) {
+            std::string name;
+            uint64_t version{}, checksum{}, size{};
+            if (!in.get(name) || !in.get(version) || !in.get(checksum) || !in.get(size))
+                return false;
+            auto&& payload = in.take(size);
+            if (!in.ok() || version != CATALOG_VERSION || fnv1a(payload) != checksum)
+                return false;
+            sections.emplace(std::move(name), payload);
+        }
+
+        auto&& load_section = [&sections](const std::string& name, auto& target) {
+            auto&& it = sections.find(name);
+            if (it == sections.end()) return false;
+            Byte_reader section_in(it->second);
+            return target.deserialize(section_in) && section_in.at_end();
+        };
+        const bool LOADED = load_section("year", year_idx) && load_section("pages", pages_idx) &&
+                            load_section("borrowed", borrowed_idx) && load_section("title", title_idx) &&
+                            load_section("author", author_idx) && load_section("publisher", publisher_idx) &&
+                            load_section("all", all_books) && load_section("available", available_books);
+        return LOADED && year_idx.size() == books_json.size();
+    }
+
+    static void save_indexes(std::string_view catalog) {
+        const uint64_t CATALOG_VERSION = FileSystem::version_of(catalog);
+        Byte_writer out;
+        out.put(INDEX_FILE_MAGIC).put(INDEX_FILE_FORMAT).put(uint32_t(8));
+        auto&& save_section = [&](std::string_view name, auto&& serialize) {
+            Byte_writer section;
+            serialize(section);
+            out.put(name).put(CATALOG_VERSION).put(fnv1a(section.data())).put(uint64_t(section.size()));
+            out.put_raw(section.data());
+        };
+        save_section("year", [](Byte_writer& section) { year_idx.serialize(section); });
+        save_section("pages", [](Byte_writer& section) { pages_idx.serialize(section); });
+        save_section("borrowed", [](Byte_writer& section) { borrowed_idx.serialize(section); });
+        save_section("title", [](Byte_writer& section) { title_idx.serialize(section); });
+        save_section("author", [](Byte_writer& section) { author_idx.serialize(section); });
+        save_section("publisher", [](Byte_writer& section) { publisher_idx.serialize(section); });
+        save_section("all", [](Byte_writer& section) { all_books.serialize(section); });
+        save_section("available", [](Byte_writer& section) { available_books.serialize(section); });
+        FileSystem::write_bytes(index_file(catalog), out.data());
+    }
 
    public:
     static void load_books(std::string_view filename) {
+        catalog_file = filename;
         FileSystem::load(filename, books_json);
+        migrate();
         if (!books_json.empty()) {
             for (const auto& [_, data] : books_json.items())
                 global_book_id = std::max(global_book_id, data.at("ID").get<size_t>());
             global_book_id += 1;
         }
+        if (!load_indexes(filename)) {
+            // stale or missing, the catalog is usable right away and queries wait for the rebuild
+            indexes_ready = std::async(std::launch::async, rebuild_indexes).share();
+        }
+    }
+
+    // the index file goes out with every catalog save, stamped with the version just written
+    static void save_books(std::string_view filename) {
+        wait_indexes();
+        FileSystem::save(filename, books_json);
+        if (!books_json.empty()) save_indexes(filename);
     }
     [[nodiscard]] static const auto& get_json() { return books_json; }
+
+    // same title by the same author is the same book, further copies go to its counters
+    [[nodiscard]] static std::optional<size_t> find(std::string_view title, std::string_view author) {
+        wait_indexes();
+        auto&& posting = title_idx.find(title);
+        if (posting == nullptr) return std::nullopt;
+        std::optional<size_t> found;
+        posting->for_each([&](uint32_t id) {
+            if (!found && books_json.at(key_of(id)).at("Author").get_ref<const std::string&>() == author) found = id;
+        });
+        return found;
+    }
+
+    // loans used to name the book by title only; of several copies with that title the one
+    // whose last reader is this reader is the one they hold
+    [[nodiscard]] static std::optional<size_t> find_taken(std::string_view title, size_t reader_id) {
+        wait_indexes();
+        auto&& posting = title_idx.find(title);
+        if (posting == nullptr) return std::nullopt;
+        std::optional<size_t> found;
+        posting->for_each([&](uint32_t id) {
+            if (!found || books_json.at(key_of(id)).at("Last reader").get<size_t>() == reader_id) found = id;
+        });
+        return found;
+    }
+
+    // rows must be validated already, a title + author that is already in the catalog (or earlier
+    // in the batch) adds copies instead; the catalog is flushed once at the end, returns new records
+    static size_t insert_batch(const std::vector<Book_row>& rows) {
+        wait_indexes();
+        size_t n_new = 0;
+        for (auto&& row : rows) {
+            if (auto&& existing = find(row.title, row.author)) {
+                Book book(*existing);
+                book.set_copies(size_t(book.copies) + row.copies);
+                book.update_data();
+                book.serve_holds();
+                continue;
+            }
+            const size_t ID = global_book_id++;
+            auto& js = books_json[key_of(ID)] = {
+                {"Title", row.title},
+                {"Author", row.author},
+                {"Pages", row.pages},
+                {"ID", ID},
+                {"Last reader", 0},
+                {"Publisher", row.publisher},
+                {"Year", row.year},
+                {"Copies", row.copies},
+                {"Available", row.copies},
+                {"Borrowed", 0},
+            };
+            index(js);
+            ++n_new;
+        }
+        if (!catalog_file.empty()) save_books(catalog_file);
+        return n_new;
+    }
+    [[nodiscard]] static const auto& year_index() {
+        wait_indexes();
+        return year_idx;
+    }
+    [[nodiscard]] static const auto& pages_index() {
+        wait_indexes();
+        return pages_idx;
+    }
+    [[nodiscard]] static const auto& borrowed_index() {
+        wait_indexes();
+        return borrowed_idx;
+    }
+    [[nodiscard]] static const auto& author_index() {
+        wait_indexes();
+        return author_idx;
+    }
+    [[nodiscard]] static const auto& publisher_index() {
+        wait_indexes();
+        return publisher_idx;
+    }
+    [[nodiscard]] static const auto& all_ids() {
+        wait_indexes();
+        return all_books;
+    }
+    [[nodiscard]] static const auto& available() {
+        wait_indexes();
+        return available_books;
+    }
+    // lending is User's, it plugs itself in once the loan ledger is loaded; until then nothing is served
+    static void set_hold_lender(bool (*lender)(size_t reader_id, Book& book)) { hold_lender = lender; }
+    [[nodiscard]] static std::string key_of(size_t id) { return std::to_string(id); }
+    [[nodiscard]] static const auto& title_of(size_t id) {
+        return books_json.at(key_of(id)).at("Title").get_ref<const std::string&>();
+    }
     [[nodiscard]] static std::vector<Book> get_vector() {
         return books_json.items() |
-               std::views::transform([](auto&& json_item) { return Book(json_item.key()); }) |
+               std::views::transform([](auto&& json_item) { return Book(json_item.value().at("ID").template get<size_t>()); }) |
                std::ranges::to<std::vector<Book>>();
     }
 
    private:
-    bool in_library{};
+    uint16_t copies{1}, available_copies{1};
     uint16_t book_year{}, book_pages{};
+    uint32_t borrow_count{};
     size_t book_id{global_book_id++}, last_reader{};
     std::string author_name, book_title, book_publisher;
 
+    // every mutator calls this, the record's cached table rows are stale from here on
+    void touch() const { Row_cache::touch(books_json, book_id); }
+
    public:
-    Book(std::string_view title) : book_title{title} {
-        const auto& CURRENT_BOOK_DATA = books_json.at(book_title);
+    using Key = size_t;
+    static constexpr const char* KEY_COLUMN = "ID";
+
+    Book(size_t id) : book_id{id} {
+        const auto& CURRENT_BOOK_DATA = books_json.at(key_of(book_id));
+        CURRENT_BOOK_DATA["Title"].get_to(book_title);
         CURRENT_BOOK_DATA["Author"].get_to(author_name);
         CURRENT_BOOK_DATA["Pages"].get_to(book_pages);
-        CURRENT_BOOK_DATA["ID"].get_to(book_id);
         CURRENT_BOOK_DATA["Last reader"].get_to(last_reader);
         CURRENT_BOOK_DATA["Publisher"].get_to(book_publisher);
         CURRENT_BOOK_DATA["Year"].get_to(book_year);
-        CURRENT_BOOK_DATA["In library"].get_to(in_library);
-        update_data();
+        CURRENT_BOOK_DATA["Copies"].get_to(copies);
+        CURRENT_BOOK_DATA["Available"].get_to(available_copies);
+        CURRENT_BOOK_DATA["Borrowed"].get_to(borrow_count);
     }
 
-    Book(std::string_view title, bool in_lib, uint16_t year,
+    Book(std::string_view title, uint16_t n_copies, uint16_t year,
          uint16_t pages_num, std::string_view author,
          std::string_view publisher)
-        : in_library{in_lib},
+        : copies{n_copies},
+          available_copies{n_copies},
           book_year{year},
           book_pages{pages_num},
           author_name{author},
           book_title{title},
           book_publisher{publisher} {
         update_data();
+        touch();
     }
 
     Book(Book&& other_book) noexcept
-        : in_library{other_book.in_library},
+        : copies{other_book.copies},
+          available_copies{other_book.available_copies},
           book_year{other_book.book_year},
           book_pages{other_book.book_pages},
+          borrow_count{other_book.borrow_count},
           book_id{other_book.book_id},
           last_reader{other_book.last_reader},
           author_name{std::move(other_book.author_name)},
@@ -72,11 +320,14 @@ class Book {
 
     ~Book() = default;
 
-    [[nodiscard]] auto is_in_library() const { return in_library; }
+    [[nodiscard]] auto is_in_library() const { return available_copies > 0; }
+    [[nodiscard]] auto get_copies() const { return copies; }
+    [[nodiscard]] auto get_available() const { return available_copies; }
     [[nodiscard]] auto get_year() const { return book_year; }
     [[nodiscard]] auto get_pages() const { return book_pages; }
     [[nodiscard]] auto get_id() const { return book_id; }
     [[nodiscard]] auto get_last_reader() const { return last_reader; }
+    [[nodiscard]] auto get_borrow_count() const { return borrow_count; }
     [[nodiscard]] auto get_author() const { return author_name; }
     [[nodiscard]] auto get_title() const { return book_title; }
     [[nodiscard]] auto get_publisher() const { return book_publisher; }
@@ -87,25 +338,70 @@ class Book {
             std::format("Издатель: {}", book_publisher),
             std::format("Год выпуска: {}", book_year),
             std::format("Кол-во страниц: {}", book_pages),
-            std::format("Статус: {}", (in_library ? "в библиотеке" : "у читателя")),
+            std::format("В наличии: {} из {}", available_copies, copies),
         };
     }
 
-    void toggle_status() { in_library = !in_library; }
-    void set_year(uint16_t new_value) { book_year = new_value; }
-    void set_pages(uint16_t new_value) { book_pages = new_value; }
-    void set_last_reader(size_t new_value) { last_reader = new_value; }
-    void set_author(std::string_view new_value) { author_name = new_value; }
-    void set_title(std::string_view new_value) { book_title = new_value; }
-    void set_publisher(std::string_view new_value) { book_publisher = new_value; }
+    // both counters change together and are written in one update_data()
+    [[nodiscard]] bool lend() {
+        if (available_copies == 0) return false;
+        --available_copies;
+        touch();
+        return true;
+    }
+    void restock() {
+        if (available_copies < copies) ++available_copies;
+        touch();
+    }
+    // never drops below the copies currently on loan, and stops at what the counter holds, so
+    // a sum of copies can be passed as is
+    void set_copies(size_t new_value) {
+        const uint16_t ON_LOAN = copies - available_copies;
+        copies = uint16_t(std::clamp<size_t>(new_value, ON_LOAN, UINT16_MAX));
+        available_copies = copies - ON_LOAN;
+        touch();
+    }
+    void set_on_loan(uint16_t on_loan) {
+        copies = std::max(copies, on_loan);
+        available_copies = copies - on_loan;
+        touch();
+    }
+    void count_borrow() {
+        ++borrow_count;
+        touch();
+    }
+    void set_year(uint16_t new_value) { book_year = new_value, touch(); }
+    void set_pages(uint16_t new_value) { book_pages = new_value, touch(); }
+    void set_last_reader(size_t new_value) { last_reader = new_value, touch(); }
+    void set_author(std::string_view new_value) { author_name = new_value, touch(); }
+    void set_title(std::string_view new_value) { book_title = new_value, touch(); }
+    void set_publisher(std::string_view new_value) { book_publisher = new_value, touch(); }
+    // call after any change that may free a copy (a return, more copies): the free copies go to the
+    // readers queued for this book, first in line first, before anyone else can take them. Returns
+    // who got one
+    std::vector<size_t> serve_holds() {
+        std::vector<size_t> served;
+        while (hold_lender != nullptr && available_copies > 0) {
+            auto&& next = Hold_queues::serve(book_id);
+            if (!next) break;
+            if (hold_lender(*next, *this)) served.push_back(*next);
+        }
+        return served;
+    }
+
     void update_data() const {
-        nlohmann::json& js = books_json[book_title];
+        wait_indexes();
+        nlohmann::json& js = books_json[key_of(book_id)];
+        js["Title"] = book_title;
         js["Author"] = author_name;
         js["Pages"] = book_pages;
         js["ID"] = book_id;
         js["Last reader"] = last_reader;
         js["Publisher"] = book_publisher;
         js["Year"] = book_year;
-        js["In library"] = in_library;
+        js["Copies"] = copies;
+        js["Available"] = available_copies;
+        js["Borrowed"] = borrow_count;
+        index(js);
     }
 };
\ No newline at end of file
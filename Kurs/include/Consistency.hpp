@@ -0,0 +1,73 @@
+#pragma once
+#include <algorithm>
+#include <execution>
+#include <format>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "Book.hpp"
+#include "Loans.hpp"
+#include "Log.hpp"
+#include "User.hpp"
+#include "thirdparty/json.hpp"
+
+namespace CONSISTENCY {
+    enum Problem : uint8_t {
+        broken_record,  // missing fields or wrong types
+        key_mismatch,   // json key differs from the "ID" field
+        count_mismatch  // "Available" disagrees with "Copies" minus the loans in the ledger
+    };
+
+    struct Issue {
+        Problem problem;
+        std::string book_key;
+    };
+
+    [[nodiscard]] inline std::optional<Issue> check_book(const std::string& key, const nlohmann::json& data) {
+        static constexpr const char* NUMBER_FIELDS[] = {"ID", "Year", "Pages", "Last reader", "Borrowed", "Copies", "Available"};
+        static constexpr const char* STRING_FIELDS[] = {"Title", "Author", "Publisher"};
+        const bool WELL_FORMED = data.is_object() &&
+                                 std::ranges::all_of(NUMBER_FIELDS, [&](auto&& f) { return data.contains(f) && data[f].is_number_unsigned(); }) &&
+                                 std::ranges::all_of(STRING_FIELDS, [&](auto&& f) { return data.contains(f) && data[f].is_string(); });
+        if (!WELL_FORMED)
+            return Issue{broken_record, key};
+        if (Book::key_of(data["ID"].get<size_t>()) != key)
+            return Issue{key_mismatch, key};
+        const size_t ON_LOAN = Loan_ledger::holders_of(data["ID"].get<size_t>()).size();
+        if (data["Available"].get<size_t>() + ON_LOAN != data["Copies"].get<size_t>())
+            return Issue{count_mismatch, key};
+        return std::nullopt;
+    }
+
+    // validates every book in parallel; copy counters are recomputed from the loan ledger,
+    // everything else is only reported
+    inline void check_and_repair() {
+        const auto& books = Book::get_json();
+
+        std::vector<std::pair<const std::string*, const nlohmann::json*>> records;
+        records.reserve(books.size());
+        for (auto&& it = books.begin(); it != books.end(); ++it)
+            records.emplace_back(&it.key(), &it.value());
+
+        std::vector<std::optional<Issue>> found(records.size());
+        std::transform(std::execution::par, records.begin(), records.end(), found.begin(), [](auto&& record) {
+            return check_book(*record.first, *record.second);
+        });
+
+        size_t n_issues = 0, n_repaired = 0;
+        for (auto&& issue : found) {
+            if (!issue) continue;
+            ++n_issues;
+            if (issue->problem == count_mismatch) {
+                Book book(books.at(issue->book_key).at("ID").get<size_t>());
+                book.set_on_loan(uint16_t(Loan_ledger::holders_of(book.get_id()).size()));
+                book.update_data();
+                book.serve_holds();
+                ++n_repaired;
+            }
+        }
+        if (n_issues > 0)
+            Logger::Warning(std::format("Проверка каталога: проблем {}, исправлено {}", n_issues, n_repaired));
+    }
+}  // namespace CONSISTENCY
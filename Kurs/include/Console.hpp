@@ -1,112 +1,91 @@
 #pragma once
-#define NOMINMAX
-#include <Windows.h>
-
-#include <concepts>
+#include <deque>
 #include <format>
-#include <iostream>
+#include <memory>
 #include <string>
+#include <utility>
+
+#include "Terminal.hpp"
+#ifdef _WIN32
+#include "Terminal_win.hpp"
+#else
+#include "Terminal_posix.hpp"
+#endif
 
 #define GETTER [[nodiscard]] inline decltype(auto)
 #define SETTER inline void
 
 namespace Console {
-    template <std::integral T>
-    struct SZ {
-        T width, height;
-        constexpr SZ() : width{}, height{} {}
-        constexpr SZ(T&& w, T&& h) : width{w}, height{h} {}
-        constexpr SZ(const T& w, const T& h) : width{w}, height{h} {}
-    };
-
-    GETTER getSizeByPixels() {
-        RECT rect{};
-        GetWindowRect(GetConsoleWindow(), &rect);
-        return SZ{rect.right - rect.left, rect.bottom - rect.top};
+#ifdef _WIN32
+    using Platform_terminal = Win_terminal;
+#else
+    using Platform_terminal = Posix_terminal;
+#endif
+
+    // every console call goes through this backend, swap it for another ITerminal to run without a real console
+    inline std::unique_ptr<ITerminal> terminal = std::make_unique<Platform_terminal>();
+    inline size_t bytes_written{};
+
+    // returns the previous backend
+    inline std::unique_ptr<ITerminal> setTerminal(std::unique_ptr<ITerminal> new_terminal) {
+        terminal->flush();
+        return std::exchange(terminal, std::move(new_terminal));
     }
 
-    GETTER getSizeByChars() {
-        auto&& handle = GetStdHandle(STD_OUTPUT_HANDLE);
-        CONSOLE_SCREEN_BUFFER_INFO csbi{};
-        GetConsoleScreenBufferInfo(handle, &csbi);
-        return SZ{csbi.srWindow.Right - csbi.srWindow.Left + 1,
-                  csbi.srWindow.Bottom - csbi.srWindow.Top + 1};
+    // buffered, goes out with the next flush or key read
+    SETTER write(std::string_view bytes) {
+        bytes_written += bytes.size();
+        terminal->write(bytes);
     }
 
-    SETTER setSizeByPixels(const SZ<uint16_t>& newSize) {
-        const auto& [W, H] = newSize;
-        RECT rect{};
-        GetWindowRect(GetConsoleWindow(), &rect);
-        MoveWindow(GetConsoleWindow(), rect.left, rect.top, W, H, TRUE);
+    // one logical write is one flush, frames are composed before they get here
+    SETTER writeRaw(std::string_view bytes) {
+        write(bytes);
+        terminal->flush();
     }
 
-    SETTER setSizeByChars(const SZ<int16_t>& newSize) {
-        auto&& handle = GetStdHandle(STD_OUTPUT_HANDLE);
-        auto&& [w, h] = newSize;
-        COORD coord{w, h};
-        SMALL_RECT Rect{0, 0, w - 1, h - 1};
-        SetConsoleScreenBufferSize(handle, coord);
-        SetConsoleWindowInfo(handle, TRUE, &Rect);
-    }
+    inline std::deque<int> unread_keys{};
 
-    GETTER getFontSize() {
-        auto cfi = CONSOLE_FONT_INFOEX{.cbSize = sizeof(CONSOLE_FONT_INFOEX)};
-        GetCurrentConsoleFontEx(GetStdHandle(STD_OUTPUT_HANDLE), NULL, &cfi);
-        return cfi.dwFontSize.X;
+    GETTER readKey() {
+        if (!unread_keys.empty()) {
+            terminal->flush();
+            int key = unread_keys.front();
+            unread_keys.pop_front();
+            return key;
+        }
+        return terminal->read_key();
     }
 
-    SETTER setFont(int16_t newFontSize, const wchar_t* newFont = L"Consolas") {
-        auto&& handle = GetStdHandle(STD_OUTPUT_HANDLE);
-        auto cfi = CONSOLE_FONT_INFOEX{.cbSize = sizeof(CONSOLE_FONT_INFOEX)};
-        GetCurrentConsoleFontEx(handle, NULL, &cfi);
-        swprintf_s(cfi.FaceName, newFont);
-        cfi.dwFontSize.Y = newFontSize;
-        SetCurrentConsoleFontEx(handle, NULL, &cfi);
-    }
+    // readKey() returns these in order before waiting, for keys read by someone they were not meant for;
+    // a 0/224 prefix goes back together with its scan code
+    SETTER unreadKey(int key) { unread_keys.push_back(key); }
 
-    SETTER toggleCursor() {
-        CONSOLE_CURSOR_INFO cci;
-        GetConsoleCursorInfo(GetStdHandle(STD_OUTPUT_HANDLE), &cci);
-        cci.bVisible = !cci.bVisible;
-        SetConsoleCursorInfo(GetStdHandle(STD_OUTPUT_HANDLE), &cci);
-    }
+    GETTER getSizeByChars() { return terminal->size(); }
+
+    SETTER setSizeByPixels(const SZ<uint16_t>& newSize) { terminal->set_pixel_size(newSize); }
+
+    SETTER setFont(int16_t newFontSize, const wchar_t* newFont = L"Consolas") { terminal->set_font(newFontSize, newFont); }
+
+    SETTER toggleCursor() { terminal->toggle_cursor(); }
 
     SETTER setCursorPos(const Console::SZ<int16_t>& place) {
-        auto&& handle = GetStdHandle(STD_OUTPUT_HANDLE);
-        const auto& [newX, newY] = place;
-        SetConsoleCursorPosition(handle, {newX, newY});
+        writeRaw(std::format("\x1B[{};{}H", place.height + 1, place.width + 1));  // CUP, 1-based
     }
 
-    GETTER getWindowInfo() {
-        auto&& handle = GetStdHandle(STD_OUTPUT_HANDLE);
-        CONSOLE_SCREEN_BUFFER_INFO csbi{};
-        GetConsoleScreenBufferInfo(handle, &csbi);
-        return csbi;
-    }
+    SETTER clear() { writeRaw("\x1B[2J\x1B[H"); }
 
-    SETTER setTitle(std::string_view newTitle) {
-        SetConsoleTitle(std::wstring{newTitle.begin(), newTitle.end()}.c_str());
-    }
+    SETTER setTitle(std::string_view newTitle) { terminal->set_title(newTitle); }
+
+    SETTER onClose(void (*callback)()) { terminal->on_close(callback); }
 
     SETTER configure(std::string_view title, const SZ<uint16_t>& size) {
-        auto&& handle = GetStdHandle(STD_OUTPUT_HANDLE);
-        DWORD m{};
-        GetConsoleMode(handle, &m);
-        SetConsoleMode(handle, (m |= ENABLE_VIRTUAL_TERMINAL_PROCESSING));
         setTitle(title);
         setSizeByPixels(size);
     }
 
     SETTER putStr(std::string_view str, const SZ<int16_t>& place) {
-        setCursorPos(place);
-        std::cout << str;
+        writeRaw(std::format("\x1B[{};{}H{}", place.height + 1, place.width + 1, str));
     }
 
-    GETTER getCursorPosition() {
-        auto&& handle = GetStdHandle(STD_OUTPUT_HANDLE);
-        CONSOLE_SCREEN_BUFFER_INFO csbi{};
-        GetConsoleScreenBufferInfo(handle, &csbi);
-        const auto& [X, Y] = csbi.dwCursorPosition;
-        return SZ<int16_t>{X, Y};
-    }
-}  // namespace Console
\ No newline at end of file
+    GETTER getCursorPosition() { return terminal->cursor(); }
+}  // namespace Console
@@ -1,18 +1,23 @@
 #pragma once
-#define NOMINMAX
-#include <conio.h>
-
 #include <algorithm>
 #include <format>
-#include <iostream>
+#include <functional>
+#include <sstream>
 #include <map>
 #include <memory>
+#include <optional>
 #include <ranges>
+#include <set>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "Console.hpp"
 #include "Log.hpp"
+#include "Row_cache.hpp"
+#include "Screen.hpp"
+#include "Utf8.hpp"
 #include "Utils.hpp"
 #include "thirdparty/json.hpp"
 
@@ -25,6 +30,7 @@ enum Sort_Method : uint8_t {
 
 enum Keys : uint16_t {
     BACKSPACE = 8,
+    TAB = 9,
     ENTER = 13,
     ESCAPE = 27,
     SPACE = 32,
@@ -48,11 +54,85 @@ struct Console_wrapper {
     static inline char vert_symb = '|', hor_symb = '-';
     static constexpr uint8_t BORDER_PADDING = 2;
     static inline int16_t CON_WIDTH{}, CON_HEIGHT{}, CURSOR_X{}, CURSOR_Y{};
+    static inline Screen screen{};
+
+    struct Render_stats {
+        size_t keystrokes{}, bytes{}, last_bytes{};
+        [[nodiscard]] double bytes_per_key() const { return keystrokes ? double(bytes) / keystrokes : 0.0; }
+    };
+    static inline Render_stats render_stats{};
+
+   private:
+    static constexpr size_t NO_KEY = SIZE_MAX;
+    static constexpr int32_t FIRST_DRAW = -1;  // the key a list loop starts with, nothing pressed yet
+    static inline bool retained{};
+    static inline size_t bytes_at_key{NO_KEY};  // output counter when the last key was read
+
+    // while alive, writes go to `screen` and reach the terminal only through present(),
+    // so a keystroke costs just the lines it changed
+    struct Retained_scope {
+        const bool OUTER = retained;
+        Retained_scope() {
+            if (!OUTER) {
+                screen.invalidate();  // others may have written since the last frame
+                Logger::console_sink = log_to_screen;
+            }
+            retained = true;
+        }
+        ~Retained_scope() {
+            present();
+            retained = OUTER;
+            if (!OUTER) {
+                Logger::console_sink = nullptr;
+                bytes_at_key = NO_KEY;
+            }
+        }
+    };
+
+    // a log line written while a frame is retained lands in it at the cursor and goes out at once,
+    // like an error would
+    static void log_to_screen(std::string_view text) {
+        for (size_t start = 0;;) {
+            const size_t END = std::min(text.find('\n', start), text.size());
+            write(text.substr(start, END - start));
+            if (END == text.size()) break;
+            new_line();
+            start = END + 1;
+        }
+        present();
+    }
+
+    static void present() { Console::writeRaw(screen.present() + Screen::cursor_to(CURSOR_X, CURSOR_Y)); }
+
+    // the bytes written between two key reads are the cost of the first key's redraw
+    [[nodiscard]] static int read_key() {
+        present();
+        if (bytes_at_key != NO_KEY) {
+            render_stats.last_bytes = Console::bytes_written - bytes_at_key;
+            render_stats.bytes += render_stats.last_bytes;
+            ++render_stats.keystrokes;
+        }
+        const int KEY = Console::readKey();
+        bytes_at_key = Console::bytes_written;
+        return KEY;
+    }
+
+    // a list's footer line followed by what the keys of its hook do
+    [[nodiscard]] static std::string with_hint(std::string line, const std::string& keys_hint) {
+        if (!keys_hint.empty()) line.append(line.empty() ? "" : "; ").append(keys_hint);
+        return line;
+    }
 
+   public:
+    // keys a list does not use itself go to this; true means the key was taken and the rows and
+    // header were changed in place, the list redraws and stays open. keys_hint tells the user about them
+    using Key_hook = std::function<bool(int)>;
+
+    // only the size is asked for, the cursor is wherever our own writes and moves left it; asking the
+    // terminal for it is a round trip per frame
     static inline void update() {
         auto&& [W, H] = Console::getSizeByChars();
-        auto&& [X, Y] = Console::getCursorPosition();
-        CON_WIDTH = W, CON_HEIGHT = H, CURSOR_X = X, CURSOR_Y = Y;
+        CON_WIDTH = W, CON_HEIGHT = H;
     }
 
     static inline void new_line() {
@@ -66,18 +146,23 @@ struct Console_wrapper {
 
     static inline void new_cursor_pos(const Console::SZ<int16_t>& new_pos) {
         CURSOR_X = new_pos.width, CURSOR_Y = new_pos.height;
-        Console::setCursorPos(new_pos);
+        if (!retained) Console::setCursorPos(new_pos);
     }
 
-    static void vec_write(const std::vector<std::string>& DATA, bool enumerate = true, std::string_view header = "") {
+    // DATA is any random-access range of strings; a lazy one is read only for the rows a page shows
+    template <typename Rows = std::vector<std::string>>
+    static void vec_write(const Rows& DATA, bool enumerate = true, const std::string& header = {}, const Key_hook& on_key = {},
+                          const std::string& keys_hint = {}) {
         if (DATA.empty()) {
             Logger::Error("Вектор пуст!");
             return;
         }
+        Retained_scope scope;
         draw_frame();
         const bool ACTIVE_HEADER = !header.empty();
         const int32_t REAL_HEIGHT = CON_HEIGHT - BORDER_PADDING - int(ACTIVE_HEADER);
         const int32_t CHUNKED_SZ = REAL_HEIGHT - 1;
+        const int32_t FOOTER = on_key ? 1 : 0;
 
         auto&& enumed_range = DATA | std::views::enumerate;
         auto&& print_subrange = [&](auto&& subrange) {
@@ -87,28 +172,45 @@ struct Console_wrapper {
                 writeln(enumerate ? std::format(enumed_range_ELEM_FMT, idx + 1, data) : data);
         };
 
-        if (int32_t(REAL_HEIGHT - DATA.size()) >= 0) {
+        if (int32_t(REAL_HEIGHT - FOOTER - DATA.size()) >= 0) {
             print_subrange(enumed_range);
+            while (on_key) {
+                write(keys_hint);
+                // a prefix and its scan code are one key, read and handed back together
+                const int KEY = read_key();
+                const bool EXTENDED = KEY == 0 || KEY == 224;
+                const int SCAN_CODE = EXTENDED ? Console::readKey() : 0;
+                if (EXTENDED || !on_key(KEY)) {  // not for the list, it answers whoever asks for a key next
+                    Console::unreadKey(KEY);
+                    if (EXTENDED) Console::unreadKey(SCAN_CODE);
+                    break;
+                }
+                draw_frame();
+                print_subrange(enumed_range);
+            }
         } else {
             auto&& chunked = enumed_range | std::views::chunk(CHUNKED_SZ);
             const size_t N_PAGES = chunked.size();
             auto&& page_clamp = std::bind(std::clamp<int16_t>, std::placeholders::_1, 0, N_PAGES - 1);
-            int16_t current_page = 0, pressed_key = 0;
+            int16_t current_page = 0;
+            int32_t pressed_key = FIRST_DRAW;
             do {
                 draw_frame();
                 if (pressed_key == Keys::LEFT_ARR)
                     current_page = page_clamp(--current_page);
                 else if (pressed_key == Keys::RIGHT_ARR)
                     current_page = page_clamp(++current_page);
+                else if (pressed_key != FIRST_DRAW && on_key && on_key(pressed_key))
+                    draw_frame();  // the hook may have drawn over the frame
                 print_subrange(chunked[current_page]);
-                write(std::format("{} страница из {}", current_page + 1, N_PAGES));
-            } while ((pressed_key = _getch()) != Keys::ENTER);
+                write(with_hint(std::format("{} страница из {}", current_page + 1, N_PAGES), keys_hint));
+            } while ((pressed_key = read_key()) != Keys::ENTER);
         }
     }
 
     static void draw_frame(std::string title = "") {
         update();
-        const size_t TITLE_LEN = my_strlen(title);
+        const size_t TITLE_LEN = Utf8::width(title);
         const bool ENABLE_TITLE = TITLE_LEN > 0 && TITLE_LEN < CON_WIDTH;
         if (ENABLE_TITLE) {
             const std::string N_SYMB((CON_WIDTH / 2) - (TITLE_LEN / 2), hor_symb);
@@ -119,18 +221,42 @@ struct Console_wrapper {
         const std::string VERT_BORDER = vert_symb + std::string(CON_WIDTH - BORDER_PADDING, ' ') + vert_symb;
         const int16_t MAX_Y_POS = CON_HEIGHT - 1;
 
-        Console::putStr(ENABLE_TITLE ? title : HOR_BORDER, {0, 0});
-        Console::putStr(HOR_BORDER, {0, MAX_Y_POS});
+        // composed off-screen and sent as one write instead of a cursor move + write per line
+        screen.resize(CON_WIDTH, CON_HEIGHT);
+        screen.put(0, 0, ENABLE_TITLE ? title : HOR_BORDER);
+        screen.put(0, MAX_Y_POS, HOR_BORDER);
         for (int16_t i = 1; i < MAX_Y_POS; i++)
-            Console::putStr(VERT_BORDER, {0, i});
-        new_cursor_pos({1, 1});
+            screen.put(0, i, VERT_BORDER);
+        CURSOR_X = 1, CURSOR_Y = 1;
+        if (!retained) {
+            screen.invalidate();
+            present();
+        }
     }
 
+    // whatever does not fit before the right border is cut and ends with an ellipsis
     static void write(std::string_view str) {
-        const int32_t ACTUAL_WIDTH = CON_WIDTH - BORDER_PADDING;
-        const size_t STR_LENGTH = my_strlen(str);
-        const ptrdiff_t FITTED_PART = ACTUAL_WIDTH - (CURSOR_X + STR_LENGTH);
-        std::cout << (FITTED_PART >= 0 ? str : cut_str(str, STR_LENGTH + FITTED_PART));
+        const int32_t ROOM = CON_WIDTH - BORDER_PADDING - CURSOR_X;
+        const auto FITTED = Utf8::fit(str, size_t(std::max(ROOM, 0)));
+        if (retained) {
+            screen.put(CURSOR_X, CURSOR_Y, FITTED.head);
+            if (FITTED.ellipsis) screen.put(CURSOR_X + int16_t(FITTED.width - Utf8::ELLIPSIS.size()), CURSOR_Y, Utf8::ELLIPSIS);
+        } else {
+            Console::write(FITTED.head);
+            if (FITTED.ellipsis) Console::write(Utf8::ELLIPSIS);
+            Console::terminal->flush();
+        }
+        CURSOR_X += int16_t(FITTED.width);
+    }
+
+    // blanks the cell before the cursor and moves onto it
+    static void erase_back() {
+        if (CURSOR_X <= 1) return;
+        --CURSOR_X;
+        if (retained)
+            screen.put(CURSOR_X, CURSOR_Y, " ");
+        else
+            Console::writeRaw("\b \b");
     }
 
     static inline void writeln(std::string_view msg) {
@@ -138,40 +264,49 @@ struct Console_wrapper {
         new_line();
     }
 
+    // numbers are typed through the same key source as text, so a scripted session can answer both
     template <typename T>
     [[nodiscard]] constexpr static T get_inline_input(bool password = false, char symb = '*') {
         update();
-        T buf{};
-        if constexpr (std::is_same_v<T, std::string>) {
-            do {
-                const char KEY = _getch();
-                if (KEY == Keys::ENTER) {
-                    if (buf.empty()) continue;
-                    break;
-                }
-                if (KEY == Keys::BACKSPACE) {
-                    if (!buf.empty()) {
-                        buf.pop_back();
-                        write("\b \b");
-                    }
-                    continue;
+        std::string buf;
+        do {
+            const int KEY = Console::readKey();
+            if (KEY == 0 || KEY == 224) {  // arrow or function key, its scan code follows
+                (void)Console::readKey();
+                continue;
+            }
+            if (KEY == Keys::ENTER) {
+                if (buf.empty()) continue;
+                break;
+            }
+            if (KEY == Keys::BACKSPACE) {
+                if (!buf.empty()) {
+                    buf.pop_back();
+                    erase_back();
                 }
-                buf.push_back(KEY);
-                write(std::string(1, password ? symb : KEY));
-            } while (true);
+                continue;
+            }
+            buf.push_back(char(KEY));
+            write(std::string(1, password ? symb : char(KEY)));
+        } while (true);
+        new_line();
+        if constexpr (std::is_same_v<T, std::string>) {
+            return buf;
         } else {
-            (std::cin >> buf).get();
+            T value{};
+            std::istringstream(buf) >> value;
+            return value;
         }
-        new_line();
-        return buf;
     }
 
-    template <typename Ret_Type>
-    [[nodiscard]] static Ret_Type vec_pick(const std::vector<std::string>& DATA, bool enumerate = true, std::string_view header = "") {
+    template <typename Ret_Type, typename Rows = std::vector<std::string>>
+    [[nodiscard]] static Ret_Type vec_pick(const Rows& DATA, bool enumerate = true, const std::string& header = {},
+                                           const Key_hook& on_key = {}, const std::string& keys_hint = {}) {
         if (DATA.empty()) {
             Logger::Error("Вектор пуст!");
             return {};
         }
+        Retained_scope scope;
         draw_frame();
         int32_t selected_idx = -1;
         const bool ACTIVE_HEADER = !header.empty();
@@ -185,9 +320,11 @@ struct Console_wrapper {
         auto&& subrange_selection = [&](const auto& subrange) -> int32_t {
             auto&& keys = subrange | std::views::keys | std::views::common;
             auto&& in_page_clamp = std::bind(std::clamp<int32_t>, std::placeholders::_1, keys.front(), keys.back());
-            int32_t scoped_idx = in_page_clamp(0), pressed_key = 0;
-            do {
+            int32_t scoped_idx = in_page_clamp(0);
+            for (int32_t pressed_key = FIRST_DRAW;; pressed_key = read_key()) {
                 switch (pressed_key) {
+                    case FIRST_DRAW:
+                        break;
                     case Keys::DOWN_ARR:
                         scoped_idx = in_page_clamp(++scoped_idx);
                         break;
@@ -195,9 +332,11 @@ struct Console_wrapper {
                         scoped_idx = in_page_clamp(--scoped_idx);
                         break;
                     case Keys::ENTER:
-                        break;
+                        return scoped_idx;
                     case Keys::ESCAPE:
                         return -1;
+                    default:
+                        if (!on_key || !on_key(pressed_key)) continue;  // not taken, nothing to redraw
                 }
                 draw_frame();
                 print_header();
@@ -205,9 +344,8 @@ struct Console_wrapper {
                     auto formatted_str = enumerate ? std::format(enumed_range_ELEM_FMT, idx + 1, data) : data;
                     writeln((scoped_idx == idx ? std::format("> {}", formatted_str) : formatted_str));
                 }
-                writeln("Нажмите ENTER чтобы подтвердить выбор");
-            } while (pressed_key = _getch());
-            return scoped_idx;
+                writeln(with_hint("Нажмите ENTER чтобы подтвердить выбор", keys_hint));
+            }
         };
 
         if (int32_t(REAL_HEIGHT - DATA.size()) >= 0) {
@@ -217,17 +355,22 @@ struct Console_wrapper {
             const auto& chunked = enumed_range | std::views::chunk(CHUNKED_SZ);
             const size_t N_PAGES = chunked.size();
             auto&& page_clamp = std::bind(std::clamp<int16_t>, std::placeholders::_1, 0, N_PAGES - 1);
-            int16_t current_page = 0, pressed_key = 0;
-            do {
-                draw_frame();
+            int16_t current_page = 0;
+            for (int32_t pressed_key = FIRST_DRAW;; pressed_key = read_key()) {
                 switch (pressed_key) {
+                    case FIRST_DRAW:
+                    case Keys::ENTER:
+                        break;
                     case Keys::LEFT_ARR:
                         current_page = page_clamp(--current_page);
                         break;
                     case Keys::RIGHT_ARR:
                         current_page = page_clamp(++current_page);
                         break;
+                    default:
+                        if (!on_key || !on_key(pressed_key)) continue;  // not taken, nothing to redraw
                 }
+                draw_frame();
 
                 const auto& CURRENT_CHUNK = chunked[current_page];
                 print_header();
@@ -239,8 +382,8 @@ struct Console_wrapper {
                         break;
                     writeln("Нажмите ESCAPE чтобы снова выбрать нужную страницу");
                 }
-                write(std::format("{} страница из {}, нажите Enter чтобы начать выбор строки", current_page + 1, N_PAGES));
-            } while (pressed_key = _getch());
+                write(with_hint(std::format("{} страница из {}, нажите Enter чтобы начать выбор строки", current_page + 1, N_PAGES), keys_hint));
+            }
         }
         if constexpr (std::is_integral_v<Ret_Type>)
             return selected_idx;
@@ -251,47 +394,204 @@ struct Console_wrapper {
     class Table {
        private:
         constexpr static inline int16_t EACH_PADDING = 1, MAX_STRLEN = 25;
+        constexpr static inline const char* KEYS_HINT = "Tab/Backspace: столбцы, Space: выбор столбцов";
         constexpr static inline auto&& restrict_len = std::bind(std::clamp<size_t>, std::placeholders::_1, 0, MAX_STRLEN);
 
        private:
-        std::string table_header, last_key;
+        // one column of the layout: its width in terminal columns and the most bytes a cell of it can take
+        struct Column {
+            std::string key;
+            size_t width{}, bytes{};
+        };
+
+        struct Layout {
+            std::vector<Column> columns{};
+            size_t row_bytes{};
+            uint64_t signature{};  // cached rows are only valid for the layout they were formatted with
+        };
+
+        // layouts of recently shown record sets, so a stable catalog is not measured again either
+        static inline std::unordered_map<uint64_t, Layout> recent_layouts{};
+        static constexpr size_t MAX_RECENT_LAYOUTS = 32;
+
+        std::string table_header;
         std::vector<std::string> table_rows{};
+        std::vector<bool> row_ready{};  // formatted for the current view
         std::vector<nlohmann::json> json_objects{};
-        std::map<std::string, size_t> max_cols_widths{};
+        const nlohmann::json* source{};
+        Layout layout{};
+
+        // what is on screen: the columns the user did not hide, from first_shown on as many as fit
+        std::set<std::string, std::less<>> hidden{};
+        std::vector<size_t> shown{};  // indexes into layout.columns
+        size_t first_shown{}, n_visible{};
+        uint64_t view_signature{};
+
+        [[nodiscard]] static constexpr uint64_t mix(uint64_t seed, uint64_t value) {
+            return seed ^ (value + 0x9E3779B97F4A7C15ull + (seed << 6) + (seed >> 2));
+        }
+
+        [[nodiscard]] std::optional<size_t> record_id(const nlohmann::json& j) const {
+            auto&& it = j.find("ID");
+            if (source == nullptr || it == j.end() || !it->is_number_unsigned()) return std::nullopt;
+            return it->get<size_t>();
+        }
 
+        // the same records of an unchanged source give the same value, whatever their order
+        [[nodiscard]] std::optional<uint64_t> content_signature() const {
+            if (source == nullptr) return std::nullopt;
+            uint64_t ids = 0;
+            for (auto&& j : json_objects) {
+                const auto ID = record_id(j);
+                if (!ID) return std::nullopt;
+                ids += mix(0, *ID);
+            }
+            return mix(mix(mix(std::hash<const void*>{}(source), Row_cache::generation(*source)), json_objects.size()), ids);
+        }
+
+        // columns in key order, as wide as their widest cell (up to MAX_STRLEN)
         Table* calc_col_width() {
+            const auto CONTENT = content_signature();
+            if (CONTENT) {
+                if (auto&& it = recent_layouts.find(*CONTENT); it != recent_layouts.end()) {
+                    layout = it->second;
+                    return this;
+                }
+            }
+            std::map<std::string, Column> columns;
+            Cell_buf buf;
             for (auto&& j : json_objects) {
                 for (auto&& [key, value] : j.items()) {
-                    auto& current = max_cols_widths[key];
-                    current = restrict_len(std::max({current, value_view(value).length(), key.length()}));
+                    auto& column = columns[key];
+                    const auto CELL = cell_view(value, buf);
+                    column.width = restrict_len(std::max({column.width, Utf8::width(CELL), Utf8::width(key)}));
+                    column.bytes = std::max({column.bytes, CELL.size(), key.size()});
                 }
             }
-            if (!max_cols_widths.empty())
-                last_key = max_cols_widths.rbegin()->first;
+            layout = {};
+            for (auto&& [key, column] : columns) {
+                layout.columns.push_back({key, column.width, column.bytes});
+                layout.row_bytes += column.bytes + column.width + EACH_PADDING + Utf8::ELLIPSIS.size() + 1;  // worst case, '|' included
+                layout.signature = mix(mix(layout.signature, std::hash<std::string>{}(key)), column.width);
+            }
+            if (CONTENT) {
+                if (recent_layouts.size() >= MAX_RECENT_LAYOUTS) recent_layouts.clear();
+                recent_layouts[*CONTENT] = layout;
+            }
             return this;
         }
 
-        Table* generate_rows() {
-            table_rows.clear();
-            for (auto&& j : json_objects) {
-                std::string row_buf;
-                for (auto&& [key, col_width] : max_cols_widths) {
-                    const auto prepared = cut_str(value_view(j[key]), MAX_STRLEN);
-                    row_buf += place_by_width(prepared, col_width + EACH_PADDING);
-                    if (key != last_key) row_buf += '|';
-                }
-                table_rows.push_back(std::move(row_buf));
+        [[nodiscard]] auto visible_columns() const {
+            return shown | std::views::drop(first_shown) | std::views::take(n_visible) |
+                   std::views::transform([this](size_t idx) -> const Column& { return layout.columns[idx]; });
+        }
+
+        [[nodiscard]] bool more_on_right() const { return first_shown + n_visible < shown.size(); }
+
+        // one marker column on the left, then whole columns while they fit the console, at least one
+        void fit_viewport() {
+            shown.clear();
+            for (size_t idx = 0; idx < layout.columns.size(); idx++)
+                if (!hidden.contains(layout.columns[idx].key)) shown.push_back(idx);
+            if (shown.empty())  // everything hidden is nothing hidden
+                for (size_t idx = 0; idx < layout.columns.size(); idx++) shown.push_back(idx);
+            first_shown = std::min(first_shown, shown.empty() ? 0 : shown.size() - 1);
+
+            const int16_t CON_W = Console::getSizeByChars().width;
+            const size_t ROOM = size_t(std::max(CON_W - BORDER_PADDING - 1 - 2, 1));  // markers on both sides
+            size_t used = 0;
+            n_visible = 0;
+            view_signature = layout.signature;
+            for (auto&& idx : shown | std::views::drop(first_shown)) {
+                const size_t W = layout.columns[idx].width + EACH_PADDING + 1;
+                if (n_visible > 0 && used + W > ROOM) break;
+                used += W, ++n_visible;
+                view_signature = mix(view_signature, idx);
+            }
+        }
+
+        // one row in one preallocated buffer, only the visible cells are cut and padded in place
+        void format_row(std::string& out, const nlohmann::json& j) const {
+            Cell_buf buf;
+            out.clear();
+            out.reserve(layout.row_bytes);
+            out += ' ';  // under the header's scroll marker
+            for (bool first = true; auto&& column : visible_columns()) {
+                if (!std::exchange(first, false)) out += '|';
+                const auto IT = j.find(column.key);
+                const auto CELL = IT == j.end() ? std::string_view{} : cell_view(*IT, buf);
+                Utf8::pad(out, Utf8::fit(CELL, MAX_STRLEN), column.width + EACH_PADDING);
+            }
+        }
+
+        // Tab and Backspace scroll the columns, Space picks which of them are shown
+        bool on_key(int key) {
+            switch (key) {
+                case Keys::TAB:
+                    if (more_on_right()) ++first_shown;
+                    break;
+                case Keys::BACKSPACE:
+                    if (first_shown > 0) --first_shown;
+                    break;
+                case Keys::SPACE:
+                    choose_columns();
+                    break;
+                default:
+                    return false;
             }
+            generate_header()->generate_rows();
+            return true;
+        }
+
+        void choose_columns() {
+            while (true) {
+                std::vector<std::string> lines;
+                for (auto&& column : layout.columns)
+                    lines.push_back(std::format("[{}] {}", hidden.contains(column.key) ? ' ' : 'x', column.key));
+                lines.push_back("Готово");
+                const auto PICKED = size_t(vec_pick<int32_t>(lines, false, "Какие столбцы показывать:"));
+                if (PICKED >= layout.columns.size()) break;
+                if (auto&& key = layout.columns[PICKED].key; !hidden.erase(key)) hidden.insert(key);
+            }
+            first_shown = 0;
+        }
+
+        // rows are formatted when a page first shows them, see row()
+        Table* generate_rows() {
+            table_rows.resize(json_objects.size());
+            row_ready.assign(json_objects.size(), false);
             return this;
         }
 
+        // a record's row for the current view, from Row_cache unless the record was edited since or
+        // was never shown with these columns
+        const std::string& row(size_t idx) {
+            auto& out = table_rows[idx];
+            if (row_ready[idx]) return out;
+            row_ready[idx] = true;
+            const auto ID = record_id(json_objects[idx]);
+            if (ID) {
+                if (auto&& cached = Row_cache::find(*source, *ID, view_signature)) return out = *cached;
+            }
+            format_row(out, json_objects[idx]);
+            if (ID) Row_cache::store(*source, *ID, view_signature, out);
+            return out;
+        }
+
+        [[nodiscard]] auto rows() {
+            return std::views::iota(uint32_t{0}, uint32_t(json_objects.size())) |
+                   std::views::transform([this](uint32_t idx) -> const std::string& { return row(idx); });
+        }
+
         Table* generate_header() {
             calc_col_width();
-            std::string header_buf;
-            for (auto&& [key, col_width] : max_cols_widths) {
-                header_buf += place_by_width(key, col_width + EACH_PADDING);
-                if (key != last_key) header_buf += '|';
+            fit_viewport();
+            std::string header_buf = first_shown > 0 ? "«" : " ";
+            for (bool first = true; auto&& column : visible_columns()) {
+                if (!std::exchange(first, false)) header_buf += '|';
+                Utf8::pad(header_buf, Utf8::fit(column.key, MAX_STRLEN), column.width + EACH_PADDING);
             }
+            if (more_on_right()) header_buf += "»";
             table_header = std::format("\033[4m{}\033[0m", header_buf);  // underlined
             return this;
         }
@@ -305,25 +605,36 @@ struct Console_wrapper {
             }
             table_ptr = std::make_unique<Table>();
             table_ptr->json_objects = represent_json(js_obj);
+            table_ptr->source = &js_obj;
             table_ptr->table_rows.reserve(table_ptr->json_objects.size());  // 1 object is 1 row
             return table_ptr;
         }
 
+        // builds the table only from the given keys of js_obj, without scanning the rest
+        static auto create_table(const nlohmann::json& js_obj, auto&& keys) {
+            std::unique_ptr<Table> table_ptr = nullptr;
+            if (js_obj.empty() || js_obj.is_null()) {
+                Logger::Error("Пусто!");
+                return table_ptr;
+            }
+            table_ptr = std::make_unique<Table>();
+            table_ptr->json_objects = represent_json(js_obj, keys);
+            table_ptr->source = &js_obj;
+            table_ptr->table_rows.reserve(table_ptr->json_objects.size());
+            return table_ptr;
+        }
+
+        // the console keeps its size, wide tables scroll by columns instead
         void view() {
             generate_header()->generate_rows();
-            const int16_t MAX_W = my_strlen(table_header) + BORDER_PADDING + 1;
-            if (MAX_W > 50)
-                Console::setSizeByChars({MAX_W, CON_HEIGHT});
-            vec_write(table_rows, false, table_header);
+            vec_write(rows(), false, table_header, [this](int key) { return on_key(key); }, KEYS_HINT);
         }
 
         template <typename Ty>
         [[nodiscard]] Ty pick() {
             generate_header()->generate_rows();
-            const int16_t MAX_W = my_strlen(table_header) + BORDER_PADDING + 1;
-            Console::setSizeByChars({MAX_W, CON_HEIGHT});
-            auto&& selected_idx = vec_pick<int32_t>(table_rows, false, table_header);
-            return Ty(json_objects[selected_idx]["Title"].get<std::string>());
+            auto&& selected_idx = vec_pick<int32_t>(rows(), false, table_header, [this](int key) { return on_key(key); }, KEYS_HINT);
+            return Ty(json_objects[selected_idx][Ty::KEY_COLUMN].template get<typename Ty::Key>());
         }
 
         Table* include_only(auto&& func) {
@@ -0,0 +1,35 @@
+#pragma once
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+namespace FileSystem {
+    inline void load(std::string_view fname, auto& store_to) {
+        if (std::filesystem::exists(fname.data()))
+            std::ifstream(fname.data()) >> store_to;
+    }
+
+    inline void save(std::string_view fname, const auto& data) {
+        if (data != decltype(data){})
+            std::ofstream(fname.data(), std::ofstream::trunc) << data;
+    }
+
+    inline std::string read_bytes(std::string_view fname) {
+        std::ifstream file(fname.data(), std::ios::binary);
+        return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    }
+
+    inline void write_bytes(std::string_view fname, std::string_view bytes) {
+        std::ofstream(fname.data(), std::ofstream::binary | std::ofstream::trunc).write(bytes.data(), bytes.size());
+    }
+
+    // cheap stamp of the file contents (size + last write time), 0 if there is no file
+    inline uint64_t version_of(std::string_view fname) {
+        std::error_code ec;
+        const auto SIZE = std::filesystem::file_size(fname.data(), ec);
+        if (ec) return 0;
+        const auto MTIME = std::filesystem::last_write_time(fname.data(), ec).time_since_epoch().count();
+        return (uint64_t(MTIME) * 0x9E3779B97F4A7C15) ^ SIZE;
+    }
+}  // namespace FileSystem
\ No newline at end of file
@@ -0,0 +1,226 @@
+#pragma once
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <deque>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "Screen.hpp"
+#include "Terminal.hpp"
+#include "Utf8.hpp"
+
+namespace Console {
+    // thrown by a scripted read_key() once every key has been handed out, ends the session being driven
+    struct Keys_exhausted : std::runtime_error {
+        Keys_exhausted() : std::runtime_error("key script exhausted") {}
+    };
+
+    // keys in the codes _getch returns, fed to Headless_terminal instead of a keyboard
+    class Key_script {
+       private:
+        std::deque<int> keys{};
+
+       public:
+        Key_script& key(int code) {
+            keys.push_back(code);
+            return *this;
+        }
+        Key_script& text(std::string_view typed) {
+            for (const char C : typed) keys.push_back(uint8_t(C));
+            return *this;
+        }
+        Key_script& up() { return key(224).key(72); }
+        Key_script& down() { return key(224).key(80); }
+        Key_script& left() { return key(224).key(75); }
+        Key_script& right() { return key(224).key(77); }
+        Key_script& enter() { return key(13); }
+        Key_script& escape() { return key(27); }
+        Key_script& backspace() { return key(8); }
+        Key_script& append(const Key_script& other) {
+            keys.insert(keys.end(), other.keys.begin(), other.keys.end());
+            return *this;
+        }
+
+        // plain text is typed as is, named keys go in braces: {up} {down} {left} {right} {enter} {esc} {bs}
+        [[nodiscard]] static Key_script parse(std::string_view script) {
+            Key_script out;
+            for (size_t i = 0; i < script.size();) {
+                const size_t CLOSE = script[i] == '{' ? script.find('}', i) : std::string_view::npos;
+                if (CLOSE == std::string_view::npos) {
+                    out.key(uint8_t(script[i++]));
+                    continue;
+                }
+                const auto NAME = script.substr(i + 1, CLOSE - i - 1);
+                if (NAME == "up") out.up();
+                else if (NAME == "down") out.down();
+                else if (NAME == "left") out.left();
+                else if (NAME == "right") out.right();
+                else if (NAME == "enter") out.enter();
+                else if (NAME == "esc") out.escape();
+                else if (NAME == "bs") out.backspace();
+                else out.text(script.substr(i, CLOSE - i + 1));  // not a key name, typed literally
+                i = CLOSE + 1;
+            }
+            return out;
+        }
+
+        [[nodiscard]] bool empty() const { return keys.empty(); }
+        [[nodiscard]] size_t size() const { return keys.size(); }
+
+        [[nodiscard]] int next() {
+            if (keys.empty()) throw Keys_exhausted{};
+            const int KEY = keys.front();
+            keys.pop_front();
+            return KEY;
+        }
+    };
+
+    // a terminal that exists only in memory: output is interpreted into a fixed-size cell grid
+    // (cursor moves, clears, line feeds, colors, titles), keys come from a Key_script.
+    // Everything sent is counted, and kept verbatim if a transcript was asked for
+    class Headless_terminal : public ITerminal {
+       public:
+        struct Counters {
+            size_t writes{}, flushes{}, bytes{}, cursor_moves{}, keys{};
+        };
+
+       private:
+        Screen grid{};
+        Key_script script{};
+        std::string out_buf{}, attributes{}, title{}, transcript{};
+        int16_t x{}, y{};
+        bool keep_transcript{}, cursor_visible{true};
+        void (*close_callback)() = nullptr;
+        Counters counters{};
+
+        void line_feed() {
+            x = 0;
+            if (++y < grid.get_height()) return;
+            grid.scroll_up();
+            y = std::max<int16_t>(grid.get_height() - 1, 0);
+        }
+
+        void put_glyph(std::string_view glyph) {
+            const auto W = int16_t(Utf8::width(glyph));
+            if (W > 0 && x + W > grid.get_width()) line_feed();
+            grid.put(x, y, attributes.append(glyph));
+            attributes.clear();
+            x += W;
+        }
+
+        // ESC [ params final; only what Console and Screen send is acted on
+        void control(std::string_view params, char final_byte, std::string_view sequence) {
+            switch (final_byte) {
+                case 'H': {
+                    int row = 1, col = 1;
+                    const auto SEMI = params.find(';');
+                    std::from_chars(params.data(), params.data() + std::min(SEMI, params.size()), row);
+                    if (SEMI != std::string_view::npos)
+                        std::from_chars(params.data() + SEMI + 1, params.data() + params.size(), col);
+                    x = int16_t(std::clamp(col - 1, 0, std::max(grid.get_width() - 1, 0)));
+                    y = int16_t(std::clamp(row - 1, 0, std::max(grid.get_height() - 1, 0)));
+                    ++counters.cursor_moves;
+                    break;
+                }
+                case 'J':
+                    if (params == "2") grid.clear();
+                    break;
+                case 'm': attributes.append(sequence); break;
+                default: break;  // cursor visibility, window ops
+            }
+        }
+
+        void interpret(std::string_view bytes) {
+            for (size_t i = 0; i < bytes.size();) {
+                const char C = bytes[i];
+                if (C == '\x1B' && i + 1 < bytes.size() && bytes[i + 1] == '[') {
+                    size_t end = i + 2;
+                    while (end < bytes.size() && (bytes[end] < 0x40 || bytes[end] > 0x7E)) ++end;
+                    if (end == bytes.size()) break;
+                    control(bytes.substr(i + 2, end - i - 2), bytes[end], bytes.substr(i, end - i + 1));
+                    i = end + 1;
+                } else if (C == '\x1B' && i + 1 < bytes.size() && bytes[i + 1] == ']') {  // OSC, ends with BEL
+                    const size_t END = std::min(bytes.find('\x07', i), bytes.size());
+                    if (const auto BODY = bytes.substr(i + 2, END - i - 2); BODY.starts_with("0;"))
+                        title = BODY.substr(2);
+                    i = END + 1;
+                } else if (C == '\x1B') {
+                    i += 2;
+                } else if (C == '\n') {
+                    line_feed(), ++i;
+                } else if (C == '\r') {
+                    x = 0, ++i;
+                } else if (C == '\b') {
+                    x = std::max<int16_t>(x - 1, 0), ++i;
+                } else {
+                    const size_t LEN = Utf8::sequence_length(C);
+                    put_glyph(bytes.substr(i, LEN));
+                    i += LEN;
+                }
+            }
+        }
+
+       public:
+        Headless_terminal(int16_t width, int16_t height, Key_script keys = {}, bool record = false)
+            : script{std::move(keys)}, keep_transcript{record} {
+            grid.resize(width, height);
+        }
+
+        void write(std::string_view bytes) override {
+            ++counters.writes;
+            out_buf += bytes;
+        }
+
+        void flush() override {
+            if (out_buf.empty()) return;
+            ++counters.flushes;
+            counters.bytes += out_buf.size();
+            if (keep_transcript) transcript += out_buf;
+            interpret(out_buf);
+            out_buf.clear();
+        }
+
+        [[nodiscard]] int read_key() override {
+            flush();
+            const int KEY = script.next();
+            ++counters.keys;
+            return KEY;
+        }
+
+        [[nodiscard]] SZ<int16_t> size() override { return {grid.get_width(), grid.get_height()}; }
+
+        [[nodiscard]] SZ<int16_t> cursor() override {
+            flush();
+            return {x, y};
+        }
+
+        void resize(const SZ<int16_t>& chars) override {
+            flush();
+            grid.resize(chars.width, chars.height);
+            x = std::clamp<int16_t>(x, 0, std::max<int16_t>(chars.width - 1, 0));
+            y = std::clamp<int16_t>(y, 0, std::max<int16_t>(chars.height - 1, 0));
+        }
+
+        void set_title(std::string_view new_title) override { title = new_title; }
+        void toggle_cursor() override { cursor_visible = !cursor_visible; }
+        void on_close(void (*callback)()) override { close_callback = callback; }
+
+        // what a user closing the window would trigger
+        void close() const {
+            if (close_callback != nullptr) close_callback();
+        }
+
+        Key_script& keys() { return script; }
+
+        [[nodiscard]] const Screen& screen() const { return grid; }
+        [[nodiscard]] std::string plain_row(int16_t row) const { return grid.plain_row(row); }
+        [[nodiscard]] const std::string& get_title() const { return title; }
+        [[nodiscard]] bool is_cursor_visible() const { return cursor_visible; }
+        [[nodiscard]] const std::string& get_transcript() const { return transcript; }
+        [[nodiscard]] const Counters& get_counters() const { return counters; }
+        void reset_counters() { counters = {}; }
+    };
+}  // namespace Console
@@ -0,0 +1,174 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Fsystem.hpp"
+#include "Log.hpp"
+#include "Serialize.hpp"
+#include "Stats.hpp"
+
+enum Loan_event : uint8_t {
+    taken,
+    returned
+};
+
+struct Loan_record {
+    int64_t timestamp;  // seconds since epoch, never decreases along the log
+    uint32_t user_id, book_id;
+    Loan_event event;
+};
+
+// append-only log of loan events in a binary segment file:
+// header, then fixed-size records in time order, so every query is a binary search
+class Loan_history {
+   private:
+    static constexpr uint32_t LOG_MAGIC = 0x474F4C4B, LOG_FORMAT = 1;  // "KLOG"
+    static constexpr size_t HEADER_SIZE = 2 * sizeof(uint32_t);
+    static constexpr size_t RECORD_SIZE = sizeof(int64_t) + 2 * sizeof(uint32_t) + sizeof(Loan_event);
+
+    static inline std::string log_file{};
+    static inline std::vector<Loan_record> records{};
+    static inline std::unordered_map<uint32_t, std::vector<uint32_t>> positions_by_book{}, positions_by_user{};
+    static inline Co_borrow_matrix co_borrows{};  // a pair counts once per reader who took both books
+
+    static void index_last() {
+        const auto POS = uint32_t(records.size() - 1);
+        positions_by_book[records.back().book_id].push_back(POS);
+        positions_by_user[records.back().user_id].push_back(POS);
+    }
+
+    [[nodiscard]] static auto by_time(const Loan_record& rec) { return rec.timestamp; }
+
+    [[nodiscard]] static std::vector<uint32_t> distinct_taken_by(uint32_t user_id) {
+        std::vector<uint32_t> result;
+        std::unordered_set<uint32_t> seen;
+        if (auto&& it = positions_by_user.find(user_id); it != positions_by_user.end()) {
+            for (auto&& pos : it->second) {
+                if (records[pos].event == Loan_event::taken && seen.insert(records[pos].book_id).second)
+                    result.push_back(records[pos].book_id);
+            }
+        }
+        return result;
+    }
+
+    static void build_co_borrows() {
+        std::vector<std::pair<uint32_t, uint32_t>> pairs;
+        for (auto&& [user_id, _] : positions_by_user) {
+            auto&& taken = distinct_taken_by(user_id);
+            for (size_t i = 0; i < taken.size(); i++)
+                for (size_t j = i + 1; j < taken.size(); j++)
+                    pairs.emplace_back(taken[i], taken[j]);
+        }
+        co_borrows.build(pairs);
+    }
+
+    // positions are in log order, hence in time order as well
+    [[nodiscard]] static std::vector<Loan_record> select(const std::vector<uint32_t>& positions, int64_t from, int64_t to) {
+        auto&& first = std::ranges::lower_bound(positions, from, {}, [](uint32_t pos) { return records[pos].timestamp; });
+        auto&& last = std::ranges::upper_bound(positions, to, {}, [](uint32_t pos) { return records[pos].timestamp; });
+        std::vector<Loan_record> result;
+        for (auto&& it = first; it < last; ++it)
+            result.push_back(records[*it]);
+        return result;
+    }
+
+   public:
+    [[nodiscard]] static int64_t now() {
+        return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    static void open(std::string_view filename) {
+        log_file = filename;
+        records.clear(), positions_by_book.clear(), positions_by_user.clear();
+        const std::string BYTES = FileSystem::read_bytes(log_file);
+        Byte_reader in(BYTES);
+        uint32_t magic{}, format{};
+        if (!in.get(magic) || !in.get(format) || magic != LOG_MAGIC || format != LOG_FORMAT) {
+            // an unreadable log is set aside, never overwritten; if that fails nothing is written to it
+            if (!BYTES.empty()) {
+                std::error_code ec;
+                std::filesystem::rename(log_file, log_file + ".bak", ec);
+                Logger::Error(std::format("Файл истории {} поврежден или устарел{}", log_file,
+                                          ec ? ", история не будет сохраняться" : std::format(", сохранен как {}.bak", log_file)));
+                if (ec) {
+                    log_file.clear();
+                    return;
+                }
+            }
+            Byte_writer header;
+            header.put(LOG_MAGIC).put(LOG_FORMAT);
+            FileSystem::write_bytes(log_file, header.data());
+            return;
+        }
+        records.reserve((BYTES.size() - HEADER_SIZE) / RECORD_SIZE);
+        Loan_record rec{};
+        while (in.get(rec.timestamp) && in.get(rec.user_id) && in.get(rec.book_id) && in.get(rec.event)) {
+            records.push_back(rec);
+            index_last();
+        }
+        build_co_borrows();
+        // a torn record at the tail (crash mid-append) is dropped
+        if (const size_t VALID_SIZE = HEADER_SIZE + records.size() * RECORD_SIZE; VALID_SIZE != BYTES.size())
+            std::filesystem::resize_file(log_file, VALID_SIZE);
+    }
+
+    static void append(size_t user_id, size_t book_id, Loan_event event) {
+        const int64_t TIMESTAMP = records.empty() ? now() : std::max(now(), records.back().timestamp);
+        if (event == Loan_event::taken) {
+            auto&& earlier = distinct_taken_by(uint32_t(user_id));
+            if (std::ranges::find(earlier, uint32_t(book_id)) == earlier.end())
+                for (auto&& other : earlier) co_borrows.add(other, uint32_t(book_id));
+        }
+        records.push_back({TIMESTAMP, uint32_t(user_id), uint32_t(book_id), event});
+        index_last();
+        if (log_file.empty()) return;
+        Byte_writer out;
+        out.put(records.back().timestamp).put(records.back().user_id).put(records.back().book_id).put(records.back().event);
+        std::ofstream(log_file, std::ofstream::binary | std::ofstream::app).write(out.data().data(), out.size());
+    }
+
+    // every event with from <= timestamp <= to
+    [[nodiscard]] static std::span<const Loan_record> between(int64_t from, int64_t to) {
+        auto&& first = std::ranges::lower_bound(records, from, {}, by_time);
+        auto&& last = std::ranges::upper_bound(records, to, {}, by_time);
+        return first < last ? std::span<const Loan_record>(first, last) : std::span<const Loan_record>{};
+    }
+
+    [[nodiscard]] static std::vector<Loan_record> of_book(size_t book_id, int64_t from = INT64_MIN, int64_t to = INT64_MAX) {
+        auto&& it = positions_by_book.find(uint32_t(book_id));
+        return it == positions_by_book.end() ? std::vector<Loan_record>{} : select(it->second, from, to);
+    }
+
+    [[nodiscard]] static std::vector<Loan_record> of_user(size_t user_id, int64_t from = INT64_MIN, int64_t to = INT64_MAX) {
+        auto&& it = positions_by_user.find(uint32_t(user_id));
+        return it == positions_by_user.end() ? std::vector<Loan_record>{} : select(it->second, from, to);
+    }
+
+    // the latest event of that kind for the book, by a given reader if user_id is set
+    [[nodiscard]] static std::optional<Loan_record> last_of_book(size_t book_id, Loan_event event,
+                                                                 std::optional<size_t> user_id = std::nullopt) {
+        auto&& it = positions_by_book.find(uint32_t(book_id));
+        if (it == positions_by_book.end())
+            return std::nullopt;
+        for (auto&& pos : it->second | std::views::reverse) {
+            if (records[pos].event == event && (!user_id || records[pos].user_id == *user_id)) return records[pos];
+        }
+        return std::nullopt;
+    }
+
+    [[nodiscard]] static const auto& all() { return records; }
+
+    // books most often taken by readers who also took book_id, (book id, readers)
+    [[nodiscard]] static auto also_taken(size_t book_id, size_t k) { return co_borrows.neighbours(uint32_t(book_id), k); }
+};
@@ -0,0 +1,232 @@
+#pragma once
+#include <algorithm>
+#include <charconv>
+#include <execution>
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <ranges>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "Book.hpp"
+#include "User.hpp"
+#include "Utils.hpp"
+#include "thirdparty/json.hpp"
+
+namespace IMPORT {
+    struct Report {
+        size_t imported{}, skipped{}, merged{};  // merged: rows that only added copies to an existing book
+    };
+
+    [[nodiscard]] inline bool is_jsonl(std::string_view path) {
+        const auto EXT = std::filesystem::path(path).extension();
+        return EXT == ".jsonl" || EXT == ".ndjson";
+    }
+
+    // splits one CSV line, "quoted, fields" and "" escapes are supported
+    [[nodiscard]] inline std::vector<std::string> split_csv(std::string_view line) {
+        std::vector<std::string> fields(1);
+        bool quoted = false;
+        for (size_t i = 0; i < line.size(); i++) {
+            const char CH = line[i];
+            if (quoted) {
+                if (CH == '"' && i + 1 < line.size() && line[i + 1] == '"')
+                    fields.back() += '"', ++i;
+                else if (CH == '"')
+                    quoted = false;
+                else
+                    fields.back() += CH;
+            } else if (CH == '"') {
+                quoted = true;
+            } else if (CH == ',') {
+                fields.emplace_back();
+            } else if (CH != '\r') {
+                fields.back() += CH;
+            }
+        }
+        return fields;
+    }
+
+    // a header names exactly these columns in this order, the trailing ones after n_required may be left out
+    [[nodiscard]] inline bool is_header(std::string_view line, std::initializer_list<std::string_view> columns, size_t n_required) {
+        auto&& fields = split_csv(line);
+        return fields.size() >= n_required && fields.size() <= columns.size() &&
+               std::ranges::equal(fields, columns | std::views::take(fields.size()));
+    }
+
+    // up to max_lines non-blank lines from where the stream is, fewer only at its end
+    [[nodiscard]] inline std::vector<std::string> read_lines(std::istream& in, size_t max_lines) {
+        std::vector<std::string> lines;
+        for (std::string line; lines.size() < max_lines && std::getline(in, line);) {
+            if (line.ends_with('\r')) line.pop_back();
+            if (!line.empty()) lines.push_back(std::move(line));
+        }
+        return lines;
+    }
+
+    struct Raw_account {
+        std::string login, password;
+        User_role role{User_role::user};
+        bool valid{};
+    };
+
+    // CSV: login,password[,role]  JSONL: {"login": ..., "password": ..., "role": "admin"|"user"}
+    [[nodiscard]] inline Raw_account parse_account(std::string_view line, bool jsonl) {
+        Raw_account acc;
+        auto&& parse_role = [](std::string_view role) { return role == "admin" || role == "0" ? User_role::admin : User_role::user; };
+        if (jsonl) {
+            const auto J = nlohmann::json::parse(line, nullptr, false);
+            if (J.is_discarded() || !J.contains("login") || !J.contains("password") ||
+                !J["login"].is_string() || !J["password"].is_string())
+                return acc;
+            acc.login = J["login"].get<std::string>();
+            acc.password = J["password"].get<std::string>();
+            if (J.contains("role") && J["role"].is_string()) acc.role = parse_role(J["role"].get<std::string>());
+        } else {
+            auto&& fields = split_csv(line);
+            if (fields.size() < 2) return acc;
+            acc.login = std::move(fields[0]);
+            acc.password = std::move(fields[1]);
+            if (fields.size() > 2) acc.role = parse_role(fields[2]);
+        }
+        acc.valid = !acc.login.empty() && !acc.password.empty();
+        return acc;
+    }
+
+    // streamed BATCH_LINES lines at a time, so memory stays bounded by one batch: each batch is parsed,
+    // checked against the accounts (earlier batches included) and itself, hashed in parallel and
+    // inserted; users.json is flushed once at the end
+    inline Report import_users(std::string_view path) {
+        constexpr size_t BATCH_LINES = 4096;
+        std::ifstream file(path.data());
+        const bool JSONL = is_jsonl(path);
+        Report report;
+        for (bool first = true;; first = false) {
+            auto&& lines = read_lines(file, BATCH_LINES);
+            if (lines.empty()) break;
+            if (first && !JSONL && is_header(lines.front(), {"login", "password", "role"}, 2))
+                lines.erase(lines.begin());
+
+            std::vector<Raw_account> parsed(lines.size());
+            std::transform(std::execution::par, lines.begin(), lines.end(), parsed.begin(),
+                           [JSONL](const std::string& line) { return parse_account(line, JSONL); });
+
+            std::unordered_set<std::string_view> batch_logins;
+            std::vector<const Raw_account*> accepted;
+            for (auto&& acc : parsed) {
+                if (!acc.valid || User::exists(acc.login) || !batch_logins.insert(acc.login).second) {
+                    ++report.skipped;
+                    continue;
+                }
+                accepted.push_back(&acc);
+            }
+
+            std::vector<Account_row> rows(accepted.size());
+            std::transform(std::execution::par, accepted.begin(), accepted.end(), rows.begin(), [](const Raw_account* acc) {
+                return Account_row{acc->login, encrypt_str(acc->password, acc->login.length()), acc->role};
+            });
+            User::insert_batch(rows);
+            report.imported += rows.size();
+        }
+        User::save_accounts();
+        return report;
+    }
+
+    template <std::integral T>
+    [[nodiscard]] inline bool parse_number(std::string_view str, T& out) {
+        return std::from_chars(str.data(), str.data() + str.size(), out).ec == std::errc{};
+    }
+
+    // CSV: title,author,publisher,year,pages[,copies]
+    // JSONL: {"Title", "Author", "Publisher", "Year", "Pages"[, "Copies"]}, the catalog's own field names
+    [[nodiscard]] inline Book_row parse_book(std::string_view line, bool jsonl) {
+        Book_row row;
+        if (jsonl) {
+            const auto J = nlohmann::json::parse(line, nullptr, false);
+            if (J.is_discarded() || !J.is_object())
+                return row;
+            for (auto&& field : {"Title", "Author", "Publisher"}) {
+                if (!J.contains(field) || !J[field].is_string()) return row;
+            }
+            for (auto&& field : {"Year", "Pages"}) {
+                if (!J.contains(field) || !J[field].is_number_unsigned()) return row;
+            }
+            row.title = J["Title"].get<std::string>();
+            row.author = J["Author"].get<std::string>();
+            row.publisher = J["Publisher"].get<std::string>();
+            row.year = J["Year"].get<uint16_t>();
+            row.pages = J["Pages"].get<uint16_t>();
+            if (J.contains("Copies") && J["Copies"].is_number_unsigned()) row.copies = J["Copies"].get<uint16_t>();
+        } else {
+            auto&& fields = split_csv(line);
+            if (fields.size() < 5 || !parse_number(fields[3], row.year) || !parse_number(fields[4], row.pages))
+                return row;
+            row.title = std::move(fields[0]);
+            row.author = std::move(fields[1]);
+            row.publisher = std::move(fields[2]);
+            if (fields.size() > 5 && !parse_number(fields[5], row.copies))
+                return row;
+        }
+        row.valid = !row.title.empty() && !row.author.empty() && row.copies > 0;
+        return row;
+    }
+
+    // whole file as one buffer split into line-aligned chunks, one chunk per task
+    [[nodiscard]] inline std::vector<std::string_view> split_chunks(std::string_view bytes, size_t n_chunks) {
+        std::vector<std::string_view> chunks;
+        const size_t TARGET = std::max<size_t>(bytes.size() / std::max<size_t>(n_chunks, 1), 1);
+        while (!bytes.empty()) {
+            size_t end = std::min(TARGET, bytes.size());
+            if (auto&& nl = bytes.find('\n', end - 1); nl != std::string_view::npos)
+                end = nl + 1;
+            else
+                end = bytes.size();
+            chunks.push_back(bytes.substr(0, end));
+            bytes.remove_prefix(end);
+        }
+        return chunks;
+    }
+
+    // parses chunks in parallel, then appends everything with a single flush; a title + author
+    // already in the catalog or repeated within the file adds copies to that book
+    inline Report import_books(std::string_view path) {
+        const std::string BYTES = FileSystem::read_bytes(path);
+        const bool JSONL = is_jsonl(path);
+        std::string_view body = BYTES;
+        if (const size_t FIRST_END = std::min(body.find('\n'), body.size());
+            !JSONL && is_header(body.substr(0, FIRST_END), {"title", "author", "publisher", "year", "pages", "copies"}, 5))
+            body.remove_prefix(std::min(FIRST_END + 1, body.size()));
+        auto&& chunks = split_chunks(body, std::max(1u, std::thread::hardware_concurrency()) * 4);
+
+        std::vector<std::vector<Book_row>> parsed(chunks.size());
+        std::transform(std::execution::par, chunks.begin(), chunks.end(), parsed.begin(), [JSONL](std::string_view chunk) {
+            std::vector<Book_row> rows;
+            for (auto&& line_range : chunk | std::views::split('\n')) {
+                std::string_view line(line_range.begin(), line_range.end());
+                if (line.ends_with('\r')) line.remove_suffix(1);
+                if (line.empty()) continue;
+                rows.push_back(parse_book(line, JSONL));
+            }
+            return rows;
+        });
+
+        Report report;
+        std::vector<Book_row> accepted;
+        for (auto&& rows : parsed) {
+            for (auto&& row : rows) {
+                if (!row.valid) {
+                    ++report.skipped;
+                    continue;
+                }
+                accepted.push_back(std::move(row));
+            }
+        }
+        report.imported = Book::insert_batch(accepted);
+        report.merged = accepted.size() - report.imported;
+        return report;
+    }
+}  // namespace IMPORT
@@ -0,0 +1,182 @@
+#pragma once
+#include <functional>
+#include <ranges>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Bitmap.hpp"
+#include "Serialize.hpp"
+
+// ordered secondary index (key -> record), updates cost O(log n), range scans O(log n + k)
+template <typename Key, typename Id>
+class Range_index {
+   private:
+    using Entry = std::pair<Key, Id>;
+
+    // transparent, so range bounds are looked up by a bare key
+    struct Entry_less {
+        using is_transparent = void;
+        constexpr bool operator()(const Entry& l, const Entry& r) const { return l < r; }
+        constexpr bool operator()(const Entry& l, const Key& r) const { return l.first < r; }
+        constexpr bool operator()(const Key& l, const Entry& r) const { return l < r.first; }
+    };
+
+    std::set<Entry, Entry_less> entries{};
+    std::unordered_map<Id, Key> current_keys{};
+
+   public:
+    void update(const Id& id, const Key& key) {
+        auto&& [it, inserted] = current_keys.try_emplace(id, key);
+        if (!inserted) {
+            if (it->second == key) return;
+            entries.erase(Entry{it->second, id});
+            it->second = key;
+        }
+        entries.emplace(key, id);
+    }
+
+    void erase(const Id& id) {
+        if (auto&& it = current_keys.find(id); it != current_keys.end()) {
+            entries.erase(Entry{it->second, id});
+            current_keys.erase(it);
+        }
+    }
+
+    void clear() {
+        entries.clear();
+        current_keys.clear();
+    }
+
+    // the key id is filed under, nullptr if it is not in the index
+    [[nodiscard]] const Key* find(const Id& id) const {
+        auto&& it = current_keys.find(id);
+        return it == current_keys.end() ? nullptr : &it->second;
+    }
+
+    // ids with lo <= key <= hi, ordered by key
+    [[nodiscard]] auto range(const Key& lo, const Key& hi) const {
+        auto&& first = entries.lower_bound(lo);
+        auto&& last = hi < lo ? first : entries.upper_bound(hi);
+        return std::ranges::subrange(first, last) | std::views::values;
+    }
+
+    [[nodiscard]] auto greater_than(const Key& key) const {
+        return std::ranges::subrange(entries.upper_bound(key), entries.end()) | std::views::values;
+    }
+
+    // (key, id) pairs from the largest key down
+    [[nodiscard]] auto descending() const { return entries | std::views::reverse; }
+
+    [[nodiscard]] auto size() const { return entries.size(); }
+
+    void serialize(Byte_writer& out) const {
+        out.put(uint64_t(entries.size()));
+        for (auto&& [key, id] : entries) out.put(key).put(id);
+    }
+
+    // entries are stored in order, so the set is refilled with end hints in O(n)
+    [[nodiscard]] bool deserialize(Byte_reader& in) {
+        clear();
+        uint64_t n_entries{};
+        in.get(n_entries);
+        for (uint64_t i = 0; i < n_entries && in.ok(); i++) {
+            Key key{};
+            Id id{};
+            if (in.get(key) && in.get(id)) {
+                entries.emplace_hint(entries.end(), key, id);
+                current_keys.emplace(id, key);
+            }
+        }
+        return in.ok();
+    }
+};
+
+struct String_hash {
+    using is_transparent = void;
+    size_t operator()(std::string_view str) const { return std::hash<std::string_view>{}(str); }
+};
+
+// term -> records posting lists (authors, publishers), terms are interned to dense ids
+class Inverted_index {
+   private:
+    std::vector<std::string> terms{};
+    std::unordered_map<std::string, uint32_t, String_hash, std::equal_to<>> term_ids{};
+    std::vector<Roaring_bitmap> postings{};
+    std::unordered_map<size_t, uint32_t> current_terms{};
+
+    uint32_t intern(std::string_view term) {
+        if (auto&& it = term_ids.find(term); it != term_ids.end())
+            return it->second;
+        const auto TERM_ID = uint32_t(terms.size());
+        terms.emplace_back(term);
+        postings.emplace_back();
+        term_ids.emplace(terms.back(), TERM_ID);
+        return TERM_ID;
+    }
+
+   public:
+    void update(size_t id, std::string_view term) {
+        const uint32_t TERM_ID = intern(term);
+        auto&& [it, inserted] = current_terms.try_emplace(id, TERM_ID);
+        if (!inserted) {
+            if (it->second == TERM_ID) return;
+            postings[it->second].remove(uint32_t(id));
+            it->second = TERM_ID;
+        }
+        postings[TERM_ID].add(uint32_t(id));
+    }
+
+    void erase(size_t id) {
+        if (auto&& it = current_terms.find(id); it != current_terms.end()) {
+            postings[it->second].remove(uint32_t(id));
+            current_terms.erase(it);
+        }
+    }
+
+    [[nodiscard]] const Roaring_bitmap* find(std::string_view term) const {
+        auto&& it = term_ids.find(term);
+        return it == term_ids.end() ? nullptr : &postings[it->second];
+    }
+
+    [[nodiscard]] size_t count(std::string_view term) const {
+        auto&& found = find(term);
+        return found ? found->cardinality() : 0;
+    }
+
+    void serialize(Byte_writer& out) const {
+        out.put(uint32_t(terms.size()));
+        for (uint32_t i = 0; i < terms.size(); i++) {
+            out.put(std::string_view{terms[i]});
+            postings[i].serialize(out);
+        }
+    }
+
+    [[nodiscard]] bool deserialize(Byte_reader& in) {
+        *this = {};
+        uint32_t n_terms{};
+        in.get(n_terms);
+        for (uint32_t i = 0; i < n_terms && in.ok(); i++) {
+            std::string term;
+            Roaring_bitmap posting;
+            if (!in.get(term) || !posting.deserialize(in)) break;
+            const uint32_t TERM_ID = intern(term);
+            posting.for_each([&](uint32_t id) { current_terms.emplace(id, TERM_ID); });
+            postings[TERM_ID] = std::move(posting);
+        }
+        return in.ok();
+    }
+
+    // (term, number of records) for every term that still has records
+    [[nodiscard]] std::vector<std::pair<std::string_view, size_t>> counts() const {
+        std::vector<std::pair<std::string_view, size_t>> result;
+        for (uint32_t i = 0; i < terms.size(); i++) {
+            if (!postings[i].empty())
+                result.emplace_back(terms[i], postings[i].cardinality());
+        }
+        return result;
+    }
+};
@@ -5,6 +5,8 @@
 
 #include "Book.hpp"
 #include "Console_wrapper.hpp"
+#include "Import.hpp"
+#include "Stats.hpp"
 #include "User.hpp"
 #include "Utils.hpp"
 
@@ -17,11 +19,27 @@ namespace USER_Functions {
         }
         Console_wrapper::write("Введите минимальный год: ");
         auto&& year = Console_wrapper::get_inline_input<uint16_t>();
-        auto&& books_table = Console_wrapper::Table::create_table(all_books_json);
-        auto&& included = books_table->include_only([year](auto&& j) {
-            return !j["In library"] && j["Year"] > year;
-        });
-        included->get_sz() > 0 ? included->sort("Author")->view() : Logger::Error("Нет подходящих книг");
+        // taken books are the few, their years are looked up one by one
+        auto&& qualifying = (Book::all_ids() - Book::available()).to_vector() | std::views::filter([year](uint32_t id) {
+                                const auto* YEAR = Book::year_index().find(id);
+                                return YEAR != nullptr && *YEAR > year;
+                            });
+        auto&& books_table = Console_wrapper::Table::create_table(all_books_json, qualifying | std::views::transform(Book::key_of));
+        books_table->get_sz() > 0 ? books_table->sort("Author")->view() : Logger::Error("Нет подходящих книг");
+    }
+
+    void books_by_pages() {
+        auto&& all_books_json = Book::get_json();
+        if (all_books_json.empty()) {
+            Logger::Error("Список книг пока пуст!");
+            return;
+        }
+        Console_wrapper::write("Введите минимальное количество страниц: ");
+        auto&& min_pages = Console_wrapper::get_inline_input<uint16_t>();
+        Console_wrapper::write("Введите максимальное количество страниц: ");
+        auto&& max_pages = Console_wrapper::get_inline_input<uint16_t>();
+        auto&& books_table = Console_wrapper::Table::create_table(all_books_json, Book::pages_index().range(min_pages, max_pages) | std::views::transform(Book::key_of));
+        books_table->get_sz() > 0 ? books_table->view() : Logger::Error("Нет подходящих книг");
     }
 
     void view_all_books() {
@@ -35,6 +53,24 @@ namespace USER_Functions {
             ->view();
     }
 
+    void books_by_author() {
+        auto&& all_books_json = Book::get_json();
+        if (all_books_json.empty()) {
+            Logger::Error("Список книг пока пуст!");
+            return;
+        }
+        Console_wrapper::writeln("Введите автора");
+        auto&& author = Console_wrapper::get_inline_input<std::string>();
+        auto&& posting = Book::author_index().find(author);
+        if (posting == nullptr || posting->empty()) {
+            Logger::Error("Книг этого автора нет!");
+            return;
+        }
+        Console_wrapper::Table::create_table(all_books_json, posting->to_vector() | std::views::transform(Book::key_of))
+            ->sort("Year")
+            ->view();
+    }
+
     void search_book() {
         auto&& all_books_vector = Book::get_vector();
         if (all_books_vector.empty()) {
@@ -45,7 +81,12 @@ namespace USER_Functions {
         auto&& to_find = Console_wrapper::get_inline_input<std::string>();
         for (auto&& book : all_books_vector) {
             if (std::string title = book.get_title(); title.contains(to_find)) {
-                Console_wrapper::vec_write(book.get_data(), false, "Книга найдена!");
+                auto&& data = book.get_data();
+                for (auto&& holder : Loan_ledger::holders_of(book.get_id()))
+                    data.emplace_back(std::format("Читатель: {}", User::login_of(holder)));
+                if (const size_t WAITING = Hold_queues::waiting(book.get_id()); WAITING > 0)
+                    data.emplace_back(std::format("В очереди: {}", WAITING));
+                Console_wrapper::vec_write(data, false, "Книга найдена!");
                 return;
             }
         }
@@ -58,31 +99,82 @@ namespace USER_Functions {
             Logger::Error("Список книг пока пуст!");
             return;
         }
-        auto&& books_table = Console_wrapper::Table::create_table(all_books_json);
-        auto&& included = books_table->include_only([](auto&& j) {
-            return j["In library"];
-        });
-        if (included->get_sz() == 0)
+        if (Book::available().empty()) {
+            Logger::Error("Все книги на руках у читателей!");
             return;
-        auto&& book = included->pick<Book>();
-        User::get_current_user()->take_book(book);
-        book.set_last_reader(User::get_current_user()->get_reader_ID());
-        book.toggle_status();
-        book.update_data();
-        Logger::Success("Книга взята!");
+        }
+        auto&& available_keys = Book::available().to_vector() | std::views::transform(Book::key_of);
+        auto&& book = Console_wrapper::Table::create_table(all_books_json, available_keys)->pick<Book>();
+        if (!User::get_current_user()->take_book(book)) {
+            if (Loan_ledger::holds(User::get_current_user()->get_reader_ID(), book.get_id()))
+                Logger::Error("Экземпляр этой книги уже у вас!");
+            else
+                Logger::Error("Свободных экземпляров этой книги не осталось!");
+            return;
+        }
+        if (auto&& related = Loan_history::also_taken(book.get_id(), 3); !related.empty()) {
+            Console_wrapper::writeln("Читатели этой книги также брали:");
+            for (auto&& [book_id, _] : related) {
+                if (Book::get_json().contains(Book::key_of(book_id)))
+                    Console_wrapper::writeln(std::format("  {}", Book::title_of(book_id)));
+            }
+        }
+        Logger::Success("Книга взята! Осталось экземпляров:", book.get_available());
     }
 
     void return_book() {
-        auto&& taken_books = User::get_current_user()->get_taken_books();
-        if (Book::get_json().empty() || taken_books.empty()) {
+        auto&& taken_ids = User::get_current_user()->get_taken_ids();
+        if (Book::get_json().empty() || taken_ids.empty()) {
             Logger::Error("Нет взятых книг!");
             return;
         }
-        Book book(Console_wrapper::vec_pick<std::string>(taken_books));
-        User::get_current_user()->return_book(book);
-        book.toggle_status();
-        book.update_data();
-        Logger::Success("Книга возвращена!");
+        auto&& taken_titles = taken_ids | std::views::transform(Book::title_of) | std::ranges::to<std::vector<std::string>>();
+        Book book(taken_ids[Console_wrapper::vec_pick<int32_t>(taken_titles)]);
+        if (auto&& next_reader = User::get_current_user()->return_book(book))
+            Logger::Success("Книга возвращена и выдана следующему в очереди:", User::login_of(*next_reader));
+        else
+            Logger::Success("Книга возвращена!");
+    }
+
+    void reserve_book() {
+        auto&& all_books_json = Book::get_json();
+        if (all_books_json.empty()) {
+            Logger::Error("Список книг пока пуст!");
+            return;
+        }
+        auto&& unavailable = Book::all_ids() - Book::available();
+        if (unavailable.empty()) {
+            Logger::Error("Все книги есть в наличии, бронь не нужна!");
+            return;
+        }
+        auto&& unavailable_keys = unavailable.to_vector() | std::views::transform(Book::key_of);
+        auto&& book = Console_wrapper::Table::create_table(all_books_json, unavailable_keys)->pick<Book>();
+        auto&& user = User::get_current_user();
+        if (!user->reserve(book)) {
+            Logger::Error("Эта книга уже у вас или в ваших бронях!");
+            return;
+        }
+        Logger::Success("Книга забронирована! Место в очереди:", *Hold_queues::position(user->get_reader_ID(), book.get_id()));
+    }
+
+    void my_reservations() {
+        auto&& user = User::get_current_user();
+        auto&& reserved_ids = user->get_reserved_ids();
+        if (reserved_ids.empty()) {
+            Logger::Error("Нет забронированных книг!");
+            return;
+        }
+        auto&& lines = reserved_ids | std::views::transform([&user](size_t book_id) {
+                           return std::format("{} (место в очереди: {})", Book::title_of(book_id),
+                                              *Hold_queues::position(user->get_reader_ID(), book_id));
+                       }) |
+                       std::ranges::to<std::vector<std::string>>();
+        const auto PICKED = reserved_ids[Console_wrapper::vec_pick<int32_t>(lines, true, "Выберите бронь:")];
+        Console_wrapper::writeln("Отменить бронь?");
+        Console_wrapper::writeln("1) Да");
+        Console_wrapper::writeln("2) Нет");
+        if (Console_wrapper::get_inline_input<uint16_t>() == 1 && user->cancel_reservation(PICKED))
+            Logger::Success("Бронь отменена!");
     }
 
     void sort_books() {
@@ -141,6 +233,111 @@ namespace ADMIN_Functions {
             ->view();
     }
 
+    void catalog_report() {
+        if (Book::get_json().empty()) {
+            Logger::Error("Список книг пока пуст!");
+            return;
+        }
+        Console_wrapper::writeln("Выберите отчет:");
+        Console_wrapper::writeln("1) Книг по авторам");
+        Console_wrapper::writeln("2) Книг по издателям");
+        const bool BY_AUTHOR = Console_wrapper::get_inline_input<int16_t>() == 1;
+        auto&& counts = (BY_AUTHOR ? Book::author_index() : Book::publisher_index()).counts();
+        std::ranges::sort(counts, std::greater{}, [](auto&& term_count) { return term_count.second; });
+        Console_wrapper::vec_write(counts |
+                                       std::views::transform([](auto&& term_count) {
+                                           return std::format("{} - {}", term_count.first, term_count.second);
+                                       }) |
+                                       std::ranges::to<std::vector<std::string>>(),
+                                   true, BY_AUTHOR ? "Автор - количество книг" : "Издатель - количество книг");
+    }
+
+    void loan_history() {
+        Console_wrapper::writeln("Выберите отчет:");
+        Console_wrapper::writeln("1) Выдачи за последние 30 дней");
+        Console_wrapper::writeln("2) История книги");
+        std::vector<Loan_record> events;
+        if (Console_wrapper::get_inline_input<int16_t>() == 1) {
+            constexpr int64_t MONTH = 30 * 24 * 60 * 60;
+            auto&& last_month = Loan_history::between(Loan_history::now() - MONTH, Loan_history::now());
+            std::ranges::copy_if(last_month, std::back_inserter(events), [](auto&& rec) { return rec.event == Loan_event::taken; });
+        } else {
+            Console_wrapper::write("Введите ID книги: ");
+            events = Loan_history::of_book(Console_wrapper::get_inline_input<size_t>());
+        }
+        if (events.empty()) {
+            Logger::Error("Событий нет!");
+            return;
+        }
+        Console_wrapper::vec_write(events |
+                                       std::views::transform([](const Loan_record& rec) {
+                                           const auto WHEN = std::chrono::sys_seconds{std::chrono::seconds{rec.timestamp}};
+                                           const auto& books = Book::get_json();
+                                           const auto BOOK_KEY = Book::key_of(rec.book_id);
+                                           return std::format("{:%Y-%m-%d %H:%M} {} {} \"{}\"", WHEN, User::login_of(rec.user_id),
+                                                              rec.event == Loan_event::taken ? "взял" : "вернул",
+                                                              books.contains(BOOK_KEY) ? Book::title_of(rec.book_id) : BOOK_KEY);
+                                       }) |
+                                       std::ranges::to<std::vector<std::string>>(),
+                                   false, "История выдач");
+    }
+
+    void overdue_loans() {
+        constexpr size_t N_NEXT_DUE = 10;
+        auto&& format_loan = [](const Due_loan& loan) {
+            const auto DUE = std::chrono::sys_seconds{std::chrono::seconds{loan.due}};
+            return std::format("{:%Y-%m-%d} {} \"{}\"", DUE, User::login_of(loan.user_id), Book::title_of(loan.book_id));
+        };
+        auto&& lines = Loan_ledger::overdue() | std::views::transform(format_loan) | std::ranges::to<std::vector<std::string>>();
+        if (lines.empty())
+            lines.emplace_back("Просроченных книг нет");
+        lines.emplace_back(std::format("Ближайшие {} сроков возврата:", N_NEXT_DUE));
+        for (auto&& loan : Loan_ledger::next_due(N_NEXT_DUE))
+            lines.push_back(format_loan(loan));
+        Console_wrapper::vec_write(lines, false, "Просроченные книги (срок, читатель, книга)");
+    }
+
+    void most_borrowed() {
+        constexpr size_t N_TOP = 20;
+        if (Book::get_json().empty()) {
+            Logger::Error("Список книг пока пуст!");
+            return;
+        }
+        Console_wrapper::writeln("Выберите режим:");
+        Console_wrapper::writeln("1) Точный (счетчики книг)");
+        Console_wrapper::writeln("2) Приближенный (по всей истории выдач, ограниченная память)");
+        std::vector<std::pair<size_t, uint32_t>> top;
+        if (Console_wrapper::get_inline_input<int16_t>() == 1) {
+            for (auto&& [count, id] : Book::borrowed_index().descending() | std::views::take(N_TOP))
+                top.emplace_back(id, count);
+        } else {
+            Count_min_top sketch(N_TOP);
+            for (auto&& rec : Loan_history::all())
+                if (rec.event == Loan_event::taken) sketch.add(rec.book_id);
+            top = sketch.top(N_TOP);
+        }
+        const auto& books = Book::get_json();
+        Console_wrapper::vec_write(top |
+                                       std::views::filter([&books](auto&& id_count) { return books.contains(Book::key_of(id_count.first)); }) |
+                                       std::views::transform([](auto&& id_count) {
+                                           return std::format("{} - {}", Book::title_of(id_count.first), id_count.second);
+                                       }) |
+                                       std::ranges::to<std::vector<std::string>>(),
+                                   true, "Самые популярные книги (название - выдач)");
+    }
+
+    void render_stats() {
+        const auto STATS = Console_wrapper::render_stats;
+        Console_wrapper::vec_write({
+                                       std::format("Нажатий клавиш в списках: {}", STATS.keystrokes),
+                                       std::format("Отправлено байт: {}", STATS.bytes),
+                                       std::format("В среднем на нажатие: {:.1f}", STATS.bytes_per_key()),
+                                       std::format("Последнее нажатие: {}", STATS.last_bytes),
+                                       std::format("Строк таблиц из кэша: {} из {}", Row_cache::hits, Row_cache::hits + Row_cache::misses),
+                                   },
+                                   false, "Вывод в консоль");
+    }
+
     void add_book() {
         Console_wrapper::draw_frame("Добавление книги");
         Console_wrapper::write("Введите название: ");
@@ -153,10 +350,35 @@ namespace ADMIN_Functions {
         auto&& pages_buf = Console_wrapper::get_inline_input<uint16_t>();
         Console_wrapper::write("Введите год выпуска: ");
         auto&& year_buf = Console_wrapper::get_inline_input<uint16_t>();
-        Book(title_buf, true, year_buf, pages_buf, author_buf, pub_buf);
+        Console_wrapper::write("Введите количество экземпляров: ");
+        auto&& copies_buf = std::max<uint16_t>(Console_wrapper::get_inline_input<uint16_t>(), 1);
+        if (auto&& existing = Book::find(title_buf, author_buf)) {
+            Book book(*existing);
+            book.set_copies(size_t(book.get_copies()) + copies_buf);
+            book.update_data();
+            Logger::Success("Книга уже есть, экземпляров теперь:", book.get_copies());
+            if (const size_t SERVED = book.serve_holds().size(); SERVED > 0)
+                Logger::Success("Выдано читателям из очереди:", SERVED);
+            return;
+        }
+        Book(title_buf, copies_buf, year_buf, pages_buf, author_buf, pub_buf);
         Logger::Success("Книга успешно добавлена!");
     }
 
+    void import_books() {
+        Console_wrapper::draw_frame("Импорт книг");
+        Console_wrapper::writeln("Формат: CSV (title,author,publisher,year,pages[,copies]) или JSONL (.jsonl)");
+        Console_wrapper::write("Введите путь к файлу: ");
+        auto&& path = Console_wrapper::get_inline_input<std::string>();
+        if (!std::filesystem::exists(path)) {
+            Logger::Error("Файл не найден!");
+            return;
+        }
+        auto&& report = IMPORT::import_books(path);
+        Logger::Success("Импортировано:", report.imported, "добавлено экземпляров к имеющимся:", report.merged,
+                        "пропущено:", report.skipped);
+    }
+
     void add_user() {
         Console_wrapper::draw_frame("Добавление пользователя");
         auto&& all_users_json = User::get_json();
@@ -164,7 +386,7 @@ namespace ADMIN_Functions {
         auto&& login_buf = Console_wrapper::get_inline_input<std::string>();
         if (all_users_json.contains(login_buf)) {
             Logger::Error("Аккаунт с таким логином уже существует");
-            std::cin.get();
+            (void)Console::readKey();
             return;
         }
         Console_wrapper::write("Задайте пароль: ");
@@ -177,6 +399,19 @@ namespace ADMIN_Functions {
         Logger::Success("Пользователь успешно добавлен!");
     }
 
+    void import_users() {
+        Console_wrapper::draw_frame("Импорт пользователей");
+        Console_wrapper::writeln("Формат: CSV (login,password,role) или JSONL (.jsonl)");
+        Console_wrapper::write("Введите путь к файлу: ");
+        auto&& path = Console_wrapper::get_inline_input<std::string>();
+        if (!std::filesystem::exists(path)) {
+            Logger::Error("Файл не найден!");
+            return;
+        }
+        auto&& report = IMPORT::import_users(path);
+        Logger::Success("Импортировано:", report.imported, "пропущено:", report.skipped);
+    }
+
     void edit_user() {
         auto&& all_users_json = User::get_json();
         if (all_users_json.empty()) {
@@ -209,13 +444,63 @@ namespace ADMIN_Functions {
                 break;
             default:
                 Logger::Error("Неверный ввод");
-                system("pause");
+                (void)Console::readKey();
                 return;
         }
         user.update_data();
         Console_wrapper::writeln("Новые данные сохранены");
     }
 
+    void edit_book() {
+        auto&& all_books_json = Book::get_json();
+        if (all_books_json.empty()) {
+            Logger::Error("Список книг пока пуст!");
+            return;
+        }
+        auto&& book = Console_wrapper::Table::create_table(all_books_json)
+                          ->sort("ID")
+                          ->pick<Book>();
+
+        Console_wrapper::draw_frame();
+        Console_wrapper::writeln(std::format("Выбранная книга: {}", book.get_title()));
+        Console_wrapper::writeln("Выберите то, что желаете изменить:");
+        Console_wrapper::writeln("1) Название");
+        Console_wrapper::writeln("2) Автора");
+        Console_wrapper::writeln("3) Издателя");
+        Console_wrapper::writeln("4) Год выпуска");
+        Console_wrapper::writeln("5) Количество страниц");
+        Console_wrapper::writeln("6) Количество экземпляров");
+        auto&& choice = Console_wrapper::get_inline_input<uint16_t>();
+        Console_wrapper::writeln("Введите новое значение");
+        switch (choice) {
+            case 1:
+                book.set_title(Console_wrapper::get_inline_input<std::string>());
+                break;
+            case 2:
+                book.set_author(Console_wrapper::get_inline_input<std::string>());
+                break;
+            case 3:
+                book.set_publisher(Console_wrapper::get_inline_input<std::string>());
+                break;
+            case 4:
+                book.set_year(Console_wrapper::get_inline_input<uint16_t>());
+                break;
+            case 5:
+                book.set_pages(Console_wrapper::get_inline_input<uint16_t>());
+                break;
+            case 6:
+                book.set_copies(Console_wrapper::get_inline_input<uint16_t>());  // not below the copies on loan
+                break;
+            default:
+                Logger::Error("Неверный ввод");
+                return;
+        }
+        book.update_data();  // loans and history refer to the ID, the indexes are updated here
+        Console_wrapper::writeln("Новые данные сохранены");
+        if (const size_t SERVED = book.serve_holds().size(); SERVED > 0)
+            Logger::Success("Выдано читателям из очереди:", SERVED);
+    }
+
     void erase_user() {
         auto&& all_users_json = User::get_json();
         if (all_users_json.empty()) {
@@ -228,8 +513,9 @@ namespace ADMIN_Functions {
         Console_wrapper::writeln("1) Да");
         Console_wrapper::writeln("2) Нет");
         if (Console_wrapper::get_inline_input<uint16_t>() == 1) {
+            const size_t N_TAKEN = user.get_taken_ids().size();
             User::erase(user.get_login());
-            Logger::Success("Пользователь удален!");
+            Logger::Success("Пользователь удален! Возвращено книг:", N_TAKEN);
         } else {
             Logger::Warning("Действие было отменено");
         }
@@ -274,8 +560,12 @@ class User_lib : public virtual ILibrary {
         {"задание по варианту", USER_Functions::my_task},
         {"просмотреть все книги", USER_Functions::view_all_books},
         {"поиск книги", USER_Functions::search_book},
+        {"книги автора", USER_Functions::books_by_author},
+        {"книги по количеству страниц", USER_Functions::books_by_pages},
         {"взять книгу", USER_Functions::take_book},
         {"вернуть книгу", USER_Functions::return_book},
+        {"забронировать книгу", USER_Functions::reserve_book},
+        {"мои брони", USER_Functions::my_reservations},
         {"сортировка", USER_Functions::sort_books},
     };
 
@@ -299,9 +589,17 @@ class Admin_lib : virtual public ILibrary, public User_lib {
    protected:
     static inline const std::vector<FUNCTION> admin_funcs{
         {"добавить книгу", ADMIN_Functions::add_book},
+        {"импорт книг", ADMIN_Functions::import_books},
+        {"отчет по авторам и издателям", ADMIN_Functions::catalog_report},
+        {"история выдач", ADMIN_Functions::loan_history},
+        {"просроченные книги", ADMIN_Functions::overdue_loans},
+        {"самые популярные книги", ADMIN_Functions::most_borrowed},
+        {"статистика отрисовки", ADMIN_Functions::render_stats},
         {"просмотреть все учетные записи",
          ADMIN_Functions::print_all_users},
         {"добавить учетную запись", ADMIN_Functions::add_user},
+        {"импорт учетных записей", ADMIN_Functions::import_users},
+        {"отредактировать книгу", ADMIN_Functions::edit_book},
         {"отредактировать учетную запись", ADMIN_Functions::edit_user},
         {"удалить учетную запись", ADMIN_Functions::erase_user},
         {"удалить файл", ADMIN_Functions::remove_file},
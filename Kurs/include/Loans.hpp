@@ -0,0 +1,236 @@
+#pragma once
+#include <charconv>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <optional>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Fsystem.hpp"
+#include "History.hpp"
+#include "thirdparty/json.hpp"
+
+using Id_links = std::unordered_map<size_t, std::unordered_set<size_t>>;
+
+// one key per (user, book) pair, ids fit in 32 bits like in the loan history
+[[nodiscard]] inline uint64_t loan_key(size_t user_id, size_t book_id) { return uint64_t(book_id) << 32 | uint32_t(user_id); }
+
+inline void unlink_id(Id_links& links, size_t from, size_t to) {
+    if (auto&& it = links.find(from); it != links.end()) {
+        it->second.erase(to);
+        if (it->second.empty()) links.erase(it);
+    }
+}
+
+struct Due_loan {
+    int64_t due;
+    size_t book_id, user_id;
+    uint64_t sequence;  // tells a loan from an earlier one of the same book by the same reader
+    auto operator<=>(const Due_loan&) const = default;
+};
+
+// who holds what: user -> set of book ids and book -> set of holders, both O(1);
+// a user holds at most one copy of a book. The users' "Taken books" lists are the
+// persisted source of truth, due dates are derived from the loan history
+class Loan_ledger {
+   public:
+    static constexpr int64_t LOAN_PERIOD = 14 * 24 * 60 * 60;
+
+   private:
+    struct Open_loan {
+        int64_t due;
+        uint64_t sequence;
+    };
+
+    static inline Id_links books_by_user{}, holders_by_book{};
+    static inline std::unordered_map<uint64_t, Open_loan> open_loans{};
+    static inline uint64_t next_sequence{};
+    // min-heap by due date; returned loans are left in place and dropped when they surface
+    static inline std::priority_queue<Due_loan, std::vector<Due_loan>, std::greater<>> due_heap{};
+    static inline const std::unordered_set<size_t> NO_IDS{};
+
+    [[nodiscard]] static bool is_live(const Due_loan& loan) {
+        auto&& it = open_loans.find(loan_key(loan.user_id, loan.book_id));
+        return it != open_loans.end() && it->second.sequence == loan.sequence;
+    }
+
+    // pops loans in due order while pred(loan, found) holds and returns the live ones due at or
+    // after `from`; every live loan popped is put back: O(k log n)
+    [[nodiscard]] static std::vector<Due_loan> peek_while(int64_t from, auto&& pred) {
+        std::vector<Due_loan> result, skipped;
+        while (!due_heap.empty() && pred(due_heap.top(), result.size())) {
+            if (is_live(due_heap.top())) (due_heap.top().due >= from ? result : skipped).push_back(due_heap.top());
+            due_heap.pop();
+        }
+        for (auto&& loan : skipped) due_heap.push(loan);
+        for (auto&& loan : result) due_heap.push(loan);
+        return result;
+    }
+
+   public:
+    static void rebuild(const nlohmann::json& users_json) {
+        books_by_user.clear();
+        holders_by_book.clear();
+        open_loans.clear();
+        due_heap = {};
+        for (const auto& [_, data] : users_json.items()) {
+            if (!data.contains("Taken books"))
+                continue;
+            const auto USER_ID = data.at("ID").get<size_t>();
+            for (auto&& book : data["Taken books"]) {
+                if (!book.is_number_unsigned()) continue;  // a title User::load_loans could not resolve
+                const auto BOOK_ID = book.get<size_t>();
+                auto&& taken = Loan_history::last_of_book(BOOK_ID, Loan_event::taken, USER_ID);
+                take(USER_ID, BOOK_ID, (taken ? taken->timestamp : Loan_history::now()) + LOAN_PERIOD);
+            }
+        }
+    }
+
+    // copy availability is the book's own counter, this only refuses a second copy to the same user
+    static bool take(size_t user_id, size_t book_id, int64_t due = Loan_history::now() + LOAN_PERIOD) {
+        if (!open_loans.try_emplace(loan_key(user_id, book_id), Open_loan{due, next_sequence}).second)
+            return false;
+        books_by_user[user_id].insert(book_id);
+        holders_by_book[book_id].insert(user_id);
+        due_heap.push({due, book_id, user_id, next_sequence++});
+        return true;
+    }
+
+    static bool give_back(size_t user_id, size_t book_id) {
+        if (open_loans.erase(loan_key(user_id, book_id)) == 0)
+            return false;
+        unlink_id(books_by_user, user_id, book_id);
+        unlink_id(holders_by_book, book_id, user_id);
+        return true;
+    }
+
+    [[nodiscard]] static const auto& holders_of(size_t book_id) {
+        auto&& it = holders_by_book.find(book_id);
+        return it == holders_by_book.end() ? NO_IDS : it->second;
+    }
+
+    [[nodiscard]] static const auto& books_of(size_t user_id) {
+        auto&& it = books_by_user.find(user_id);
+        return it == books_by_user.end() ? NO_IDS : it->second;
+    }
+
+    [[nodiscard]] static bool holds(size_t user_id, size_t book_id) { return open_loans.contains(loan_key(user_id, book_id)); }
+
+    [[nodiscard]] static const auto& holders() { return holders_by_book; }
+
+    [[nodiscard]] static std::optional<int64_t> due_of(size_t user_id, size_t book_id) {
+        auto&& it = open_loans.find(loan_key(user_id, book_id));
+        return it == open_loans.end() ? std::nullopt : std::optional{it->second.due};
+    }
+
+    [[nodiscard]] static std::vector<Due_loan> overdue(int64_t now = Loan_history::now()) {
+        return peek_while(INT64_MIN, [now](const Due_loan& top, size_t) { return top.due < now; });
+    }
+
+    // the first `count` loans not yet overdue; the overdue ones are passed over on the way
+    [[nodiscard]] static std::vector<Due_loan> next_due(size_t count, int64_t now = Loan_history::now()) {
+        return peek_while(now, [count](const Due_loan&, size_t found) { return found < count; });
+    }
+};
+
+// per-book FIFO of readers waiting for a copy. Tickets are handed out in order and never
+// reused, so a reader's place is their ticket minus the tickets already served: enqueue,
+// serve and position are O(1), only a cancellation shifts the tickets behind it
+class Hold_queues {
+   private:
+    struct Queue {
+        uint64_t served{};
+        std::deque<size_t> readers{};
+    };
+
+    static inline std::string holds_file{};
+    static inline std::unordered_map<size_t, Queue> queue_by_book{};
+    static inline std::unordered_map<uint64_t, uint64_t> ticket_by_hold{};  // (user, book) -> ticket
+    static inline Id_links books_by_user{};
+    static inline const std::unordered_set<size_t> NO_BOOKS{};
+
+   public:
+    // {"book id": [user ids, first in line first]}; entries that are not in that shape are skipped
+    static void load(std::string_view filename) {
+        holds_file = filename;
+        queue_by_book.clear(), ticket_by_hold.clear(), books_by_user.clear();
+        nlohmann::json holds_json;
+        FileSystem::load(filename, holds_json);
+        if (!holds_json.is_object())
+            return;
+        for (auto&& [book_key, readers] : holds_json.items()) {
+            size_t book_id{};
+            const auto [END, ERR] = std::from_chars(book_key.data(), book_key.data() + book_key.size(), book_id);
+            if (ERR != std::errc{} || END != book_key.data() + book_key.size() || !readers.is_array())
+                continue;
+            for (auto&& reader : readers)
+                if (reader.is_number_unsigned()) enqueue(reader.get<size_t>(), book_id);
+        }
+    }
+
+    static void save() {
+        nlohmann::json holds_json = nlohmann::json::object();
+        for (auto&& [book_id, queue] : queue_by_book) holds_json[std::to_string(book_id)] = queue.readers;
+        FileSystem::save(holds_file, holds_json);
+    }
+
+    // false if the reader is already in this book's queue
+    static bool enqueue(size_t user_id, size_t book_id) {
+        auto& queue = queue_by_book[book_id];
+        if (!ticket_by_hold.try_emplace(loan_key(user_id, book_id), queue.served + queue.readers.size()).second)
+            return false;
+        queue.readers.push_back(user_id);
+        books_by_user[user_id].insert(book_id);
+        return true;
+    }
+
+    // removes and returns the first reader in line
+    static std::optional<size_t> serve(size_t book_id) {
+        auto&& it = queue_by_book.find(book_id);
+        if (it == queue_by_book.end())
+            return std::nullopt;
+        const size_t USER_ID = it->second.readers.front();
+        it->second.readers.pop_front();
+        ++it->second.served;
+        if (it->second.readers.empty()) queue_by_book.erase(it);
+        ticket_by_hold.erase(loan_key(USER_ID, book_id));
+        unlink_id(books_by_user, USER_ID, book_id);
+        return USER_ID;
+    }
+
+    static bool cancel(size_t user_id, size_t book_id) {
+        auto&& ticket = ticket_by_hold.find(loan_key(user_id, book_id));
+        if (ticket == ticket_by_hold.end())
+            return false;
+        auto& queue = queue_by_book.at(book_id);
+        const size_t POS = ticket->second - queue.served;
+        ticket_by_hold.erase(ticket);
+        queue.readers.erase(queue.readers.begin() + POS);
+        for (size_t i = POS; i < queue.readers.size(); i++) --ticket_by_hold[loan_key(queue.readers[i], book_id)];
+        if (queue.readers.empty()) queue_by_book.erase(book_id);
+        unlink_id(books_by_user, user_id, book_id);
+        return true;
+    }
+
+    // 1 for the next in line
+    [[nodiscard]] static std::optional<size_t> position(size_t user_id, size_t book_id) {
+        auto&& ticket = ticket_by_hold.find(loan_key(user_id, book_id));
+        if (ticket == ticket_by_hold.end())
+            return std::nullopt;
+        return ticket->second - queue_by_book.at(book_id).served + 1;
+    }
+
+    [[nodiscard]] static size_t waiting(size_t book_id) {
+        auto&& it = queue_by_book.find(book_id);
+        return it == queue_by_book.end() ? 0 : it->second.readers.size();
+    }
+
+    [[nodiscard]] static const auto& books_of(size_t user_id) {
+        auto&& it = books_by_user.find(user_id);
+        return it == books_by_user.end() ? NO_BOOKS : it->second;
+    }
+};
@@ -1,36 +1,249 @@
 #pragma once
-#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+#include "Console.hpp"
+#include "Utf8.hpp"
+
+// levels below this are compiled out, e.g. 2 keeps only warnings and errors
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 0
+#endif
 
 namespace Logger {
+    enum class Level : uint8_t { Print, Success, Warning, Error };
+
     static inline bool new_line_enabled = true;
+    static inline Level console_level = Level::Print, file_level = Level::Print;
+
+    // byte ring with one producer (the UI thread) and one consumer (the file writer), no locks:
+    // head and tail only grow, each record is a Header followed by its text. The consumer sleeps on
+    // a wakeup counter, so it can also be woken without a record
+    class Ring {
+       public:
+        struct Header {
+            uint32_t size;
+            Level level;
+            int64_t time;  // system_clock ticks
+        };
+
+       private:
+        static constexpr size_t CAPACITY = 1 << 16;
+        std::unique_ptr<char[]> data = std::make_unique<char[]>(CAPACITY);
+        alignas(64) std::atomic<size_t> head{};
+        alignas(64) std::atomic<size_t> tail{};
+        std::atomic<size_t> dropped{};
+        std::atomic<uint32_t> wakeups{};
+
+        void copy_in(size_t at, const void* from, size_t n) {
+            const size_t POS = at % CAPACITY, FIRST = std::min(n, CAPACITY - POS);
+            std::memcpy(data.get() + POS, from, FIRST);
+            std::memcpy(data.get(), static_cast<const char*>(from) + FIRST, n - FIRST);
+        }
+
+        void copy_out(size_t at, void* to, size_t n) const {
+            const size_t POS = at % CAPACITY, FIRST = std::min(n, CAPACITY - POS);
+            std::memcpy(to, data.get() + POS, FIRST);
+            std::memcpy(static_cast<char*>(to) + FIRST, data.get(), n - FIRST);
+        }
+
+       public:
+        // never blocks, a full ring drops the record and counts it
+        bool push(Level level, int64_t time, std::string_view text) {
+            text = Utf8::truncate_bytes(text, CAPACITY / 4);
+            const Header HEADER{uint32_t(text.size()), level, time};
+            const size_t H = head.load(std::memory_order_relaxed), NEED = sizeof(Header) + text.size();
+            if (CAPACITY - (H - tail.load(std::memory_order_acquire)) < NEED) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            copy_in(H, &HEADER, sizeof(Header));
+            copy_in(H + sizeof(Header), text.data(), text.size());
+            head.store(H + NEED, std::memory_order_release);
+            wake();
+            return true;
+        }
+
+        // what to pass to wait() once the records pushed so far are drained
+        [[nodiscard]] uint32_t wakeup_count() const { return wakeups.load(std::memory_order_acquire); }
+
+        // hands every record pushed so far to on_record
+        void drain(auto&& on_record) {
+            const size_t H = head.load(std::memory_order_acquire);
+            size_t t = tail.load(std::memory_order_relaxed);
+            std::string text;
+            while (t != H) {
+                Header header{};
+                copy_out(t, &header, sizeof(Header));
+                text.resize(header.size);
+                copy_out(t + sizeof(Header), text.data(), header.size);
+                on_record(header, std::string_view{text});
+                t += sizeof(Header) + header.size;
+            }
+            tail.store(t, std::memory_order_release);
+        }
+
+        // blocks until wake() is called after seen was read
+        void wait(uint32_t seen) const { wakeups.wait(seen, std::memory_order_acquire); }
+
+        void wake() {
+            wakeups.fetch_add(1, std::memory_order_release);
+            wakeups.notify_one();
+        }
+
+        [[nodiscard]] size_t take_dropped() { return dropped.exchange(0, std::memory_order_relaxed); }
+    };
+
+    // appends lines to a file, when it grows past max_bytes it becomes name.1 (name.1 becomes name.2 ...)
+    class File_sink {
+       private:
+        std::filesystem::path path;
+        size_t max_bytes, keep, written{};
+        std::ofstream out;
+
+        [[nodiscard]] std::filesystem::path numbered(size_t n) const { return std::filesystem::path{path} += std::format(".{}", n); }
+
+        void rotate() {
+            out.close();
+            std::error_code ec;
+            std::filesystem::remove(numbered(keep), ec);
+            for (size_t n = keep; n > 1; n--) std::filesystem::rename(numbered(n - 1), numbered(n), ec);
+            std::filesystem::rename(path, numbered(1), ec);
+            out.open(path, std::ios::trunc);
+            written = 0;
+        }
+
+       public:
+        File_sink(std::filesystem::path file, size_t max_file_bytes, size_t keep_files)
+            : path{std::move(file)}, max_bytes{max_file_bytes}, keep{std::max<size_t>(keep_files, 1)}, out{path, std::ios::app} {
+            std::error_code ec;
+            written = size_t(std::filesystem::file_size(path, ec));
+            if (ec) written = 0;
+        }
+
+        void write(const Ring::Header& header, std::string_view text) {
+            static constexpr std::string_view TAGS[] = {"I", "S", "W", "E"};
+            const std::chrono::system_clock::time_point TIME{std::chrono::system_clock::duration{header.time}};
+            const auto LINE = std::format("{:%F %T} [{}] {}\n", std::chrono::floor<std::chrono::milliseconds>(TIME),
+                                          TAGS[size_t(header.level)], text);
+            if (written + LINE.size() > max_bytes && written > 0) rotate();
+            out << LINE;
+            written += LINE.size();
+        }
+
+        void flush() { out.flush(); }
+    };
+
+    // the file sink lives on its own thread, the UI thread only copies the message into the ring
+    class File_writer {
+       private:
+        Ring ring{};
+        File_sink sink;
+        std::atomic<bool> stopping{};
+        std::thread thread;
+
+        void run() {
+            while (true) {
+                const uint32_t SEEN = ring.wakeup_count();
+                ring.drain([&](const Ring::Header& header, std::string_view text) { sink.write(header, text); });
+                if (const size_t DROPPED = ring.take_dropped(); DROPPED > 0)
+                    sink.write({0, Level::Warning, std::chrono::system_clock::now().time_since_epoch().count()},
+                               std::format("{} messages dropped, the log ring was full", DROPPED));
+                sink.flush();
+                if (stopping.load(std::memory_order_acquire)) break;
+                ring.wait(SEEN);
+            }
+            ring.drain([&](const Ring::Header& header, std::string_view text) { sink.write(header, text); });
+            sink.flush();
+        }
+
+       public:
+        File_writer(std::filesystem::path file, size_t max_bytes, size_t keep)
+            : sink{std::move(file), max_bytes, keep}, thread{[this] { run(); }} {}
+
+        // whatever was pushed before this still reaches the file
+        ~File_writer() {
+            stopping.store(true, std::memory_order_release);
+            ring.wake();
+            thread.join();
+        }
+
+        void push(Level level, std::string_view text) {
+            ring.push(level, std::chrono::system_clock::now().time_since_epoch().count(), text);
+        }
+    };
+
+    static inline std::unique_ptr<File_writer> file_writer{};
+    static inline std::ostringstream line{};
+
+    // while set, console output goes here instead of to the terminal; Console_wrapper points it at
+    // its off-screen frame, which would otherwise paint over lines it never saw
+    static inline void (*console_sink)(std::string_view text) = nullptr;
+
+    static inline void open_file(const std::filesystem::path& file, size_t max_bytes = 1 << 20, size_t keep = 2) {
+        file_writer = std::make_unique<File_writer>(file, max_bytes, keep);
+    }
+
+    static inline void close_file() { file_writer.reset(); }
+
+    // console output joins the terminal buffer and goes out with the next flush or key read, so it stays
+    // in order with the UI; errors are flushed at once. The file copy goes through the writer thread
+    template <Level LEVEL, typename... Args>
+    static inline void log(std::string_view color, Args&&... args) noexcept {
+        if constexpr (int(LEVEL) >= LOG_MIN_LEVEL) {
+            const bool TO_CONSOLE = LEVEL >= console_level, TO_FILE = file_writer && LEVEL >= file_level;
+            if (!TO_CONSOLE && !TO_FILE) return;
+
+            line.str({});
+            line << std::boolalpha << color;
+            ((line << std::forward<Args>(args) << ' '), ...);
+            const size_t BODY_END = size_t(line.tellp());
+            if (!color.empty()) line << "\033[0m";
+            if (new_line_enabled) line << '\n';
+            const auto& TEXT = line.view();
+
+            if (TO_FILE) {
+                auto&& body = TEXT.substr(color.size(), BODY_END - color.size());
+                file_writer->push(LEVEL, body.substr(0, body.find_last_not_of(' ') + 1));
+            }
+            if (TO_CONSOLE && console_sink != nullptr) {
+                console_sink(TEXT);
+            } else if (TO_CONSOLE) {
+                Console::write(TEXT);
+                if constexpr (LEVEL == Level::Error) Console::terminal->flush();
+            }
+        }
+    }
+
     template <typename... Args>
     static inline void Error(Args&&... args) noexcept {
-        std::cout << std::boolalpha << "\x1B[31m";
-        ((std::cout << std::forward<Args>(args) << ' '), ...);
-        std::cout << "\033[0m";
-        if (new_line_enabled) std::cout << '\n';
+        log<Level::Error>("\x1B[31m", std::forward<Args>(args)...);
     }
 
     template <typename... Args>
     static inline void Success(Args&&... args) noexcept {
-        std::cout << std::boolalpha << "\x1B[32m";
-        ((std::cout << std::forward<Args>(args) << ' '), ...);
-        std::cout << "\033[0m";
-        if (new_line_enabled) std::cout << '\n';
+        log<Level::Success>("\x1B[32m", std::forward<Args>(args)...);
     }
 
     template <typename... Args>
     static inline void Warning(Args&&... args) noexcept {
-        std::cout << std::boolalpha << "\x1B[33m";
-        ((std::cout << std::forward<Args>(args) << ' '), ...);
-        std::cout << "\033[0m";
-        if (new_line_enabled) std::cout << '\n';
+        log<Level::Warning>("\x1B[33m", std::forward<Args>(args)...);
     }
 
     template <typename... Args>
     static inline void Print(Args&&... args) noexcept {
-        std::cout << std::boolalpha;
-        ((std::cout << std::forward<Args>(args) << ' '), ...);
-        if (new_line_enabled) std::cout << '\n';
+        log<Level::Print>("", std::forward<Args>(args)...);
     }
-}  // namespace Logger
\ No newline at end of file
+}  // namespace Logger
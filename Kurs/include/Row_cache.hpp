@@ -0,0 +1,80 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "thirdparty/json.hpp"
+
+// formatted table rows kept per record and column view. A record is the json it lives in plus its
+// "ID"; edits bump the record's version through touch(), so a row is reused until the record changes.
+// Each record keeps its last few views, scrolling the columns back and forth formats nothing again
+class Row_cache {
+   private:
+    struct Record {
+        const nlohmann::json* source;
+        size_t id;
+        bool operator==(const Record&) const = default;
+    };
+
+    struct Record_hash {
+        size_t operator()(const Record& record) const noexcept {
+            return std::hash<const void*>{}(record.source) ^ (record.id * 0x9E3779B97F4A7C15ull);
+        }
+    };
+
+    struct Formatted {
+        uint64_t version, layout;
+        std::string row;
+    };
+
+    struct Entry {
+        uint64_t version{};
+        std::vector<Formatted> rows{};  // oldest first
+    };
+
+    static constexpr size_t VIEWS_PER_RECORD = 4;
+
+    static inline std::unordered_map<Record, Entry, Record_hash> entries{};
+    static inline std::unordered_map<const nlohmann::json*, uint64_t> generations{};
+
+   public:
+    static inline size_t hits{}, misses{};
+
+    // the record was edited in place, its cached row is stale
+    static void touch(const nlohmann::json& source, size_t id) {
+        ++entries[{&source, id}].version;
+        ++generations[&source];
+    }
+
+    // changes whenever any record of source is touched
+    [[nodiscard]] static uint64_t generation(const nlohmann::json& source) {
+        auto&& it = generations.find(&source);
+        return it == generations.end() ? 0 : it->second;
+    }
+
+    // the row formatted for this layout, if the record has not changed since
+    [[nodiscard]] static const std::string* find(const nlohmann::json& source, size_t id, uint64_t layout) {
+        if (auto&& it = entries.find({&source, id}); it != entries.end()) {
+            for (auto&& formatted : it->second.rows) {
+                if (formatted.layout == layout && formatted.version == it->second.version) {
+                    ++hits;
+                    return &formatted.row;
+                }
+            }
+        }
+        ++misses;
+        return nullptr;
+    }
+
+    // rows of an older version are dropped, past VIEWS_PER_RECORD the oldest view goes
+    static void store(const nlohmann::json& source, size_t id, uint64_t layout, const std::string& row) {
+        auto& entry = entries[{&source, id}];
+        std::erase_if(entry.rows, [&](const Formatted& formatted) {
+            return formatted.version != entry.version || formatted.layout == layout;
+        });
+        if (entry.rows.size() >= VIEWS_PER_RECORD) entry.rows.erase(entry.rows.begin());
+        entry.rows.push_back({entry.version, layout, row});
+    }
+};
@@ -0,0 +1,132 @@
+#pragma once
+#include <algorithm>
+#include <format>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Utf8.hpp"
+
+// off-screen character grid, one cell per terminal column; escape sequences (colors, underline)
+// take no cell and ride along with the glyph that follows them, a wide glyph is followed by an
+// empty cell. A copy of what the terminal currently shows is retained, so present() only sends
+// the rows that changed
+class Screen {
+   public:
+    using Row = std::vector<std::string>;
+
+   private:
+    int16_t width{}, height{};
+    std::vector<Row> cells{}, shown{};
+
+    // the right half of a wide glyph, or a cell holding nothing visible
+    [[nodiscard]] static bool is_tail(std::string_view cell) { return Utf8::width(cell) == 0; }
+
+    // cells [x, x + n) are about to be overwritten, a wide glyph cut in half leaves a blank behind
+    static void release(Row& row, int16_t x, int n) {
+        if (x > 0 && is_tail(row[x])) row[x - 1] = " ";
+        if (const size_t NEXT = size_t(x + n); NEXT < row.size() && is_tail(row[NEXT])) row[NEXT] = " ";
+    }
+
+   public:
+    [[nodiscard]] static std::string cursor_to(int16_t x, int16_t y) { return std::format("\x1B[{};{}H", y + 1, x + 1); }
+
+    void resize(int16_t new_width, int16_t new_height) {
+        width = std::max<int16_t>(new_width, 0), height = std::max<int16_t>(new_height, 0);
+        cells.assign(height, Row(width, " "));
+    }
+
+    void clear() {
+        for (auto&& row : cells) std::ranges::fill(row, " ");
+    }
+
+    // overwrites cells from column x on, whatever runs past the right edge is dropped
+    void put(int16_t x, int16_t y, std::string_view text) {
+        if (y < 0 || y >= height || width == 0) return;
+        auto& row = cells[y];
+        std::string pending;
+        for (size_t i = 0; i < text.size();) {
+            if (text[i] == '\x1B') {
+                const size_t END = Utf8::escape_end(text, i);
+                pending.append(text.substr(i, END - i));
+                i = END;
+                continue;
+            }
+            const auto GLYPH = text.substr(i, std::min(Utf8::sequence_length(text[i]), text.size() - i));
+            const int16_t W = int16_t(Utf8::width(GLYPH));
+            i += GLYPH.size();
+            if (W == 0) {  // combining mark, joins the glyph before it
+                int16_t at = x - 1;
+                if (at > 0 && at < width && is_tail(row[at])) --at;
+                if (at >= 0 && at < width) row[at].append(pending).append(GLYPH);
+                pending.clear();
+                continue;
+            }
+            if (x >= 0 && x + W <= width) {
+                release(row, x, W);
+                row[x] = pending;
+                row[x].append(GLYPH);
+                if (W == 2) row[x + 1].clear();
+                pending.clear();
+            }
+            x += W;
+        }
+        if (!pending.empty())  // trailing resets must not be lost, even for clipped text
+            row[std::clamp<int16_t>(x - 1, 0, width - 1)] += pending;
+    }
+
+    // drops the top row and opens a blank one at the bottom, like a terminal at its last line
+    void scroll_up() {
+        if (cells.empty()) return;
+        std::ranges::rotate(cells, cells.begin() + 1);
+        std::ranges::fill(cells.back(), " ");
+    }
+
+    [[nodiscard]] auto get_width() const { return width; }
+    [[nodiscard]] auto get_height() const { return height; }
+    [[nodiscard]] const Row& row(int16_t y) const { return cells[y]; }
+
+    // the row as it reads on screen, escape sequences left out
+    [[nodiscard]] std::string plain_row(int16_t y) const {
+        std::string out;
+        for (std::string_view cell : cells[y])
+            for (size_t i = 0; i < cell.size();)
+                if (cell[i] == '\x1B')
+                    i = Utf8::escape_end(cell, i);
+                else
+                    out += cell[i++];
+        return out;
+    }
+
+    [[nodiscard]] std::string render_row(int16_t y) const {
+        std::string out = cursor_to(0, y);
+        for (auto&& cell : cells[y]) out += cell;
+        return out;
+    }
+
+    // the whole grid as one string of positioned rows, meant for a single write
+    [[nodiscard]] std::string render() const {
+        std::string out;
+        out.reserve(size_t(width + 8) * height);
+        for (int16_t y = 0; y < height; y++) out += render_row(y);
+        return out;
+    }
+
+    // what the terminal shows is unknown (someone else wrote to it), the next present() sends everything
+    void invalidate() { shown.clear(); }
+
+    // only the rows that differ from the last presented grid, as one string
+    [[nodiscard]] std::string present() {
+        if (shown.size() != cells.size()) {
+            shown = cells;
+            return render();
+        }
+        std::string out;
+        for (int16_t y = 0; y < height; y++) {
+            if (shown[y] == cells[y]) continue;
+            out += render_row(y);
+            shown[y] = cells[y];
+        }
+        return out;
+    }
+};
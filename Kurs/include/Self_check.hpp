@@ -0,0 +1,139 @@
+#pragma once
+#include <array>
+#include <format>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Headless.hpp"
+#include "Screen.hpp"
+#include "Utf8.hpp"
+
+// checks that need neither a catalog nor a real terminal, run with --check; each one appends
+// a line per thing that went wrong
+namespace SELF_CHECK {
+    using Failures = std::vector<std::string>;
+
+    // a frame composed off-screen reaches an in-memory terminal exactly as composed, and presenting
+    // it again sends only the rows that changed
+    inline void screen_present(Failures& failures) {
+        constexpr int16_t WIDTH = 24, HEIGHT = 4;
+        Screen frame;
+        frame.resize(WIDTH, HEIGHT);
+        Console::Headless_terminal sink(WIDTH, HEIGHT);
+        auto&& expect_shown = [&](std::string_view step) {
+            for (int16_t y = 0; y < HEIGHT; y++)
+                if (sink.plain_row(y) != frame.plain_row(y))
+                    failures.push_back(std::format("Screen, {}: строка {} \"{}\" вместо \"{}\"", step, y, sink.plain_row(y), frame.plain_row(y)));
+        };
+
+        frame.put(0, 0, "Каталог книг");
+        frame.put(2, 1, "\x1B[32mOK\x1B[0m");
+        frame.put(0, 2, "漢字 wide");
+        frame.put(0, 3, "e\xCC\x81 and a line that runs past the edge");
+        sink.write(frame.present());
+        sink.flush();
+        expect_shown("первый кадр");
+        if (!sink.plain_row(0).starts_with("Каталог книг") || !sink.plain_row(2).starts_with("漢字 wide"))
+            failures.push_back("Screen, первый кадр: текст не на своем месте");
+
+        frame.put(2, 1, "\x1B[31mNO\x1B[0m");
+        const std::string DIFF = frame.present();
+        if (DIFF != frame.render_row(1))
+            failures.push_back(std::format("Screen: изменилась одна строка, а отправлено {} байт", DIFF.size()));
+        sink.write(DIFF);
+        sink.flush();
+        expect_shown("второй кадр");
+
+        if (const std::string SAME = frame.present(); !SAME.empty())
+            failures.push_back(std::format("Screen: кадр не менялся, а отправлено {} байт", SAME.size()));
+
+        frame.invalidate();
+        if (frame.present() != frame.render())
+            failures.push_back("Screen: после invalidate() кадр должен уйти целиком");
+    }
+
+    namespace detail {
+        // what the block paths must agree with: -1 for a block they hand to the slow path, else the
+        // columns step() gives for its bytes
+        [[nodiscard]] inline int block_width_by_steps(std::string_view block) {
+            for (const char C : block)
+                if (C == '\x1B' || uint8_t(C) >= 0xE0 || (uint8_t(C) & 0xFE) == 0xCC) return -1;
+            int columns = 0;
+            for (size_t i = 0; i < block.size();) {
+                int w = 0;
+                i = Utf8::detail::step(block, i, w);
+                columns += w;
+            }
+            return columns;
+        }
+
+        [[nodiscard]] inline size_t width_by_steps(std::string_view text) {
+            size_t columns = 0;
+            for (size_t i = 0; i < text.size();) {
+                int w = 0;
+                i = Utf8::detail::step(text, i, w);
+                columns += size_t(w);
+            }
+            return columns;
+        }
+
+        [[nodiscard]] inline std::string_view truncate_by_steps(std::string_view text, size_t max_columns) {
+            size_t columns = 0, i = 0;
+            while (i < text.size()) {
+                int w = 0;
+                const size_t NEXT = Utf8::detail::step(text, i, w);
+                if (columns + size_t(w) > max_columns) break;
+                columns += size_t(w), i = NEXT;
+            }
+            return text.substr(0, i);
+        }
+    }  // namespace detail
+
+    // the 16-byte block paths (SSE2 where there is one, and the 64-bit word version) against the
+    // character-by-character one, on text where two-byte characters straddle block boundaries and
+    // blocks hold combining marks (0xCC, 0xCD leads), escape sequences and wide glyphs
+    inline void utf8_block_paths(Failures& failures) {
+        static constexpr std::array<std::string_view, 10> PIECES = {
+            "a", "Zq7", "ж", "λ", "e\xCC\x81", "\xCD\x8F", "\x1B[31m", "\x1B[0m", "漢", "😀"};
+        std::mt19937 random(47);
+        auto&& report = [&](std::string_view what, std::string_view text) {
+            if (failures.size() < 20) failures.push_back(std::format("Utf8, {}: {} байт", what, text.size()));
+        };
+
+        for (int round = 0; round < 2000; round++) {
+            // a run of ASCII shifts everything after it, so every block boundary gets its split
+            std::string text(size_t(round % int(Utf8::detail::BLOCK)), '.');
+            const bool NARROW_ONLY = round % 3 == 0;  // mostly blocks the fast path takes
+            for (size_t n = random() % 48; n > 0; n--)
+                text += PIECES[NARROW_ONLY ? random() % 4 : random() % PIECES.size()];
+
+            for (size_t at = 0; at + Utf8::detail::BLOCK <= text.size(); at++) {
+                const char* const BLOCK = text.data() + at;
+                const int EXPECTED = detail::block_width_by_steps({BLOCK, Utf8::detail::BLOCK});
+#ifdef UTF8_SSE2
+                if (Utf8::detail::narrow_block_width_sse2(BLOCK) != EXPECTED) report(std::format("SSE2 блок с {}", at), text);
+#endif
+                if (Utf8::detail::narrow_block_width_swar(BLOCK) != EXPECTED) report(std::format("SWAR блок с {}", at), text);
+            }
+
+            const size_t WIDTH = Utf8::width(text);
+            if (WIDTH != detail::width_by_steps(text)) report("width", text);
+            for (size_t max_columns = 0; max_columns <= WIDTH + 1; max_columns++) {
+                const auto HEAD = Utf8::truncate(text, max_columns);
+                if (HEAD != detail::truncate_by_steps(text, max_columns)) report(std::format("truncate до {}", max_columns), text);
+                if (HEAD.size() < text.size() && Utf8::is_continuation(text[HEAD.size()]))
+                    report(std::format("truncate до {} разрезал символ", max_columns), text);
+                if (Utf8::width(HEAD) > max_columns) report(std::format("truncate до {} шире", max_columns), text);
+            }
+        }
+    }
+
+    [[nodiscard]] inline Failures run_all() {
+        Failures failures;
+        screen_present(failures);
+        utf8_block_paths(failures);
+        return failures;
+    }
+}  // namespace SELF_CHECK
@@ -0,0 +1,82 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+[[nodiscard]] constexpr uint64_t fnv1a(std::string_view bytes, uint64_t hash = 0xcbf29ce484222325) {
+    for (const char byte : bytes) {
+        hash ^= uint8_t(byte);
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
+// flat little-endian byte buffer for the binary side files (indexes, logs)
+class Byte_writer {
+   private:
+    std::string buffer{};
+
+   public:
+    template <typename T>
+        requires std::is_trivially_copyable_v<T>
+    Byte_writer& put(const T& value) {
+        buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+        return *this;
+    }
+
+    Byte_writer& put(std::string_view str) {
+        put(uint32_t(str.size()));
+        buffer.append(str);
+        return *this;
+    }
+
+    Byte_writer& put_raw(std::string_view bytes) {
+        buffer.append(bytes);
+        return *this;
+    }
+
+    [[nodiscard]] const auto& data() const { return buffer; }
+    [[nodiscard]] auto size() const { return buffer.size(); }
+};
+
+// reads what Byte_writer wrote, every getter fails softly once the input runs out
+class Byte_reader {
+   private:
+    std::string_view input;
+    bool failed{};
+
+   public:
+    Byte_reader(std::string_view bytes) : input{bytes} {}
+
+    template <typename T>
+        requires std::is_trivially_copyable_v<T>
+    bool get(T& value) {
+        if (failed || input.size() < sizeof(T)) return !(failed = true);
+        std::memcpy(&value, input.data(), sizeof(T));
+        input.remove_prefix(sizeof(T));
+        return true;
+    }
+
+    bool get(std::string& str) {
+        uint32_t len{};
+        if (!get(len) || input.size() < len) return !(failed = true);
+        str.assign(input.substr(0, len));
+        input.remove_prefix(len);
+        return true;
+    }
+
+    [[nodiscard]] std::string_view take(size_t count) {
+        if (failed || input.size() < count) {
+            failed = true;
+            return {};
+        }
+        auto&& result = input.substr(0, count);
+        input.remove_prefix(count);
+        return result;
+    }
+
+    [[nodiscard]] bool ok() const { return !failed; }
+    [[nodiscard]] bool at_end() const { return input.empty(); }
+};
@@ -0,0 +1,122 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Headless.hpp"
+#include "Terminal.hpp"
+
+// keystroke sessions: recorded off a live terminal, replayed headlessly to time every keystroke.
+// A session file starts with "size <width> <height>", then one "<microseconds since start> <key>" per line
+namespace Session {
+    using Clock = std::chrono::steady_clock;
+
+    // passes everything through to the real terminal and writes down each key it hands out
+    class Recording_terminal : public Console::ITerminal {
+       private:
+        std::unique_ptr<ITerminal> inner;
+        std::ofstream out;
+        Clock::time_point started = Clock::now();
+
+       public:
+        Recording_terminal(std::unique_ptr<ITerminal> terminal, const std::filesystem::path& file)
+            : inner{std::move(terminal)}, out{file} {
+            const auto [W, H] = inner->size();
+            out << "size " << W << ' ' << H << '\n';
+        }
+
+        void write(std::string_view bytes) override { inner->write(bytes); }
+        void flush() override { inner->flush(); }
+
+        [[nodiscard]] int read_key() override {
+            const int KEY = inner->read_key();
+            const auto ELAPSED = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - started);
+            out << ELAPSED.count() << ' ' << KEY << std::endl;  // flushed per key, a session that dies is still replayable
+            return KEY;
+        }
+
+        [[nodiscard]] Console::SZ<int16_t> size() override { return inner->size(); }
+        [[nodiscard]] Console::SZ<int16_t> cursor() override { return inner->cursor(); }
+        void resize(const Console::SZ<int16_t>& chars) override { inner->resize(chars); }
+        void set_title(std::string_view title) override { inner->set_title(title); }
+        void toggle_cursor() override { inner->toggle_cursor(); }
+        void on_close(void (*callback)()) override { inner->on_close(callback); }
+        void set_font(int16_t font_size, const wchar_t* font) override { inner->set_font(font_size, font); }
+        void set_pixel_size(const Console::SZ<uint16_t>& pixels) override { inner->set_pixel_size(pixels); }
+    };
+
+    struct Recording {
+        Console::SZ<int16_t> size{int16_t(80), int16_t(25)};
+        Console::Key_script keys{};
+    };
+
+    // timestamps are dropped, a replay runs at machine speed
+    [[nodiscard]] inline std::optional<Recording> load(const std::filesystem::path& file) {
+        std::ifstream in{file};
+        std::string tag;
+        Recording recording;
+        if (!(in >> tag >> recording.size.width >> recording.size.height) || tag != "size") return std::nullopt;
+        long long elapsed{};
+        for (int key{}; in >> elapsed >> key;) recording.keys.key(key);
+        return recording;
+    }
+
+    // a headless terminal with a stopwatch: the time from handing out a key to being asked for the next
+    // one is what the program spent on that keystroke, output flush included
+    class Timing_terminal : public Console::Headless_terminal {
+       private:
+        std::vector<Clock::duration> latencies{};
+        std::optional<Clock::time_point> handed_out{};
+        bool prefix{};  // 224 or 0 was handed out, the scan code that follows belongs to the same keystroke
+
+       public:
+        using Headless_terminal::Headless_terminal;
+
+        [[nodiscard]] int read_key() override {
+            flush();
+            if (handed_out && !prefix) latencies.push_back(Clock::now() - *handed_out);
+            const int KEY = Headless_terminal::read_key();
+            prefix = !prefix && (KEY == 0 || KEY == 224);
+            if (!prefix) handed_out = Clock::now();
+            return KEY;
+        }
+
+        [[nodiscard]] const auto& get_latencies() const { return latencies; }
+    };
+
+    struct Report {
+        size_t keystrokes{}, bytes{}, slowest{};
+        double p50{}, p90{}, p99{}, max{};  // milliseconds
+
+        [[nodiscard]] std::string to_string() const {
+            return std::format("нажатий: {}, вывод: {} байт\nзадержка, мс: p50 {:.3f}, p90 {:.3f}, p99 {:.3f}, максимум {:.3f} (нажатие №{})",
+                               keystrokes, bytes, p50, p90, p99, max, slowest + 1);
+        }
+    };
+
+    // nearest-rank percentiles over every timed keystroke
+    [[nodiscard]] inline Report make_report(const Timing_terminal& terminal) {
+        const auto& LATENCIES = terminal.get_latencies();
+        Report report{.keystrokes = LATENCIES.size(), .bytes = terminal.get_counters().bytes};
+        if (LATENCIES.empty()) return report;
+
+        auto&& to_ms = [](Clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+        std::vector<Clock::duration> sorted = LATENCIES;
+        std::ranges::sort(sorted);
+        auto&& percentile = [&](double p) {
+            const auto RANK = size_t(p * double(sorted.size()) + 0.999999);
+            return to_ms(sorted[std::clamp<size_t>(RANK, 1, sorted.size()) - 1]);
+        };
+        report.p50 = percentile(0.50), report.p90 = percentile(0.90), report.p99 = percentile(0.99);
+        report.max = to_ms(sorted.back());
+        report.slowest = size_t(std::ranges::max_element(LATENCIES) - LATENCIES.begin());
+        return report;
+    }
+}  // namespace Session
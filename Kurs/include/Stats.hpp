@@ -0,0 +1,160 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <set>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// approximate heavy hitters in bounded memory: a count-min sketch estimates
+// every id's count, only the current top candidates are kept by id
+template <size_t WIDTH = 4096, size_t DEPTH = 4>
+class Count_min_top {
+   private:
+    static constexpr std::array<uint64_t, DEPTH> SEEDS = [] {
+        std::array<uint64_t, DEPTH> seeds{};
+        for (size_t i = 0; i < DEPTH; i++) seeds[i] = 0x9E3779B97F4A7C15 * (2 * i + 1);
+        return seeds;
+    }();
+
+    std::vector<uint32_t> counters = std::vector<uint32_t>(WIDTH * DEPTH);
+    size_t capacity;
+    std::set<std::pair<uint32_t, size_t>> candidates{};  // (estimate, id)
+    std::unordered_map<size_t, uint32_t> candidate_estimates{};
+
+    [[nodiscard]] static size_t slot(size_t row, size_t id) {
+        uint64_t h = (id + 1) * SEEDS[row];
+        h ^= h >> 29;
+        return row * WIDTH + h % WIDTH;
+    }
+
+   public:
+    explicit Count_min_top(size_t top_capacity) : capacity{top_capacity} {}
+
+    uint32_t add(size_t id, uint32_t count = 1) {
+        uint32_t estimate = UINT32_MAX;
+        for (size_t row = 0; row < DEPTH; row++) {
+            auto& counter = counters[slot(row, id)];
+            counter += count;
+            estimate = std::min(estimate, counter);
+        }
+        if (auto&& it = candidate_estimates.find(id); it != candidate_estimates.end()) {
+            candidates.erase({it->second, id});
+            candidates.emplace(it->second = estimate, id);
+        } else if (candidates.size() < capacity) {
+            candidates.emplace(estimate, id);
+            candidate_estimates.emplace(id, estimate);
+        } else if (!candidates.empty() && candidates.begin()->first < estimate) {
+            candidate_estimates.erase(candidates.begin()->second);
+            candidates.erase(candidates.begin());
+            candidates.emplace(estimate, id);
+            candidate_estimates.emplace(id, estimate);
+        }
+        return estimate;
+    }
+
+    [[nodiscard]] uint32_t estimate(size_t id) const {
+        uint32_t result = UINT32_MAX;
+        for (size_t row = 0; row < DEPTH; row++)
+            result = std::min(result, counters[slot(row, id)]);
+        return result;
+    }
+
+    // (id, estimated count), most frequent first
+    [[nodiscard]] std::vector<std::pair<size_t, uint32_t>> top(size_t n) const {
+        std::vector<std::pair<size_t, uint32_t>> result;
+        for (auto it = candidates.rbegin(); it != candidates.rend() && result.size() < n; ++it)
+            result.emplace_back(it->second, it->first);
+        return result;
+    }
+};
+
+// sparse symmetric item-item co-occurrence counts: a compacted CSR part plus
+// a per-row hash delta for recent updates, memory is O(number of pairs)
+class Co_borrow_matrix {
+   private:
+    using Directed_entry = std::tuple<uint32_t, uint32_t, uint32_t>;  // (row, col, count)
+
+    std::vector<uint32_t> row_ptr{0}, cols{}, vals{};  // CSR, row r is [row_ptr[r], row_ptr[r + 1])
+    std::unordered_map<uint32_t, std::unordered_map<uint32_t, uint32_t>> delta{};
+    size_t delta_size{};
+
+    [[nodiscard]] size_t n_rows() const { return row_ptr.size() - 1; }
+
+    void assemble(std::vector<Directed_entry>& entries) {
+        std::ranges::sort(entries);
+        const uint32_t N_ROWS = entries.empty() ? 0 : std::get<0>(entries.back()) + 1;
+        row_ptr.assign(N_ROWS + 1, 0);
+        cols.clear(), vals.clear();
+        for (size_t i = 0; i < entries.size(); i++) {
+            auto&& [row, col, count] = entries[i];
+            if (i > 0 && std::get<0>(entries[i - 1]) == row && std::get<1>(entries[i - 1]) == col) {
+                vals.back() += count;
+                continue;
+            }
+            cols.push_back(col);
+            vals.push_back(count);
+            row_ptr[row + 1] = uint32_t(cols.size());
+        }
+        for (size_t row = 1; row < row_ptr.size(); row++)  // rows without entries
+            row_ptr[row] = std::max(row_ptr[row], row_ptr[row - 1]);
+    }
+
+    void compact() {
+        std::vector<Directed_entry> entries;
+        entries.reserve(cols.size() + delta_size);
+        for (uint32_t row = 0; row < n_rows(); row++) {
+            for (uint32_t i = row_ptr[row]; i < row_ptr[row + 1]; i++)
+                entries.emplace_back(row, cols[i], vals[i]);
+        }
+        for (auto&& [row, row_delta] : delta) {
+            for (auto&& [col, count] : row_delta)
+                entries.emplace_back(row, col, count);
+        }
+        delta.clear();
+        delta_size = 0;
+        assemble(entries);
+    }
+
+   public:
+    // bulk load from unordered (a, b) pairs, each counted once in both directions
+    void build(const std::vector<std::pair<uint32_t, uint32_t>>& pairs) {
+        std::vector<Directed_entry> entries;
+        entries.reserve(pairs.size() * 2);
+        for (auto&& [a, b] : pairs) {
+            entries.emplace_back(a, b, 1);
+            entries.emplace_back(b, a, 1);
+        }
+        delta.clear();
+        delta_size = 0;
+        assemble(entries);
+    }
+
+    void add(uint32_t a, uint32_t b) {
+        if (a == b) return;
+        ++delta[a][b], ++delta[b][a];
+        delta_size += 2;
+        if (delta_size > std::max<size_t>(4096, cols.size() / 4))
+            compact();
+    }
+
+    // (neighbour, count), strongest first
+    [[nodiscard]] std::vector<std::pair<uint32_t, uint32_t>> neighbours(uint32_t row, size_t k) const {
+        std::unordered_map<uint32_t, uint32_t> merged;
+        if (row < n_rows()) {
+            for (uint32_t i = row_ptr[row]; i < row_ptr[row + 1]; i++)
+                merged[cols[i]] += vals[i];
+        }
+        if (auto&& it = delta.find(row); it != delta.end()) {
+            for (auto&& [col, count] : it->second) merged[col] += count;
+        }
+        std::vector<std::pair<uint32_t, uint32_t>> result(merged.begin(), merged.end());
+        auto&& by_count = [](auto&& l, auto&& r) { return l.second > r.second || (l.second == r.second && l.first < r.first); };
+        const size_t TOP = std::min(k, result.size());
+        std::ranges::partial_sort(result, result.begin() + TOP, by_count);
+        result.resize(TOP);
+        return result;
+    }
+};
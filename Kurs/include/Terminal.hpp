@@ -0,0 +1,36 @@
+#pragma once
+#include <concepts>
+#include <cstdint>
+#include <string_view>
+
+namespace Console {
+    template <std::integral T>
+    struct SZ {
+        T width, height;
+        constexpr SZ() : width{}, height{} {}
+        constexpr SZ(T&& w, T&& h) : width{w}, height{h} {}
+        constexpr SZ(const T& w, const T& h) : width{w}, height{h} {}
+    };
+
+    // what Console needs from a platform; output is buffered until flush(), key codes follow _getch:
+    // a key without a character is 0 or 224 followed by its scan code (72 up, 80 down, 75 left,
+    // 77 right), never a lone prefix
+    struct ITerminal {
+        virtual ~ITerminal() = default;
+
+        virtual void write(std::string_view bytes) = 0;
+        virtual void flush() = 0;
+        [[nodiscard]] virtual int read_key() = 0;  // flushes first
+
+        [[nodiscard]] virtual SZ<int16_t> size() = 0;  // in characters
+        [[nodiscard]] virtual SZ<int16_t> cursor() = 0;
+        virtual void resize(const SZ<int16_t>& chars) = 0;
+        virtual void set_title(std::string_view title) = 0;
+        virtual void toggle_cursor() = 0;
+        virtual void on_close(void (*callback)()) = 0;  // window closed or session hung up
+
+        // window-level settings only some platforms have
+        virtual void set_font(int16_t, const wchar_t*) {}
+        virtual void set_pixel_size(const SZ<uint16_t>&) {}
+    };
+}  // namespace Console
@@ -0,0 +1,248 @@
+#pragma once
+#include <poll.h>
+#include <signal.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <charconv>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <format>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "Terminal.hpp"
+
+namespace Console {
+    // termios + ANSI escape sequences, keys are translated to the _getch codes Console_wrapper expects
+    class Posix_terminal : public ITerminal {
+       private:
+        static constexpr int ESCAPE_TIMEOUT_MS = 25;  // a lone ESC vs the start of an arrow sequence
+        static inline void (*close_callback)() = nullptr;
+        static inline volatile std::sig_atomic_t hung_up = 0;
+        std::string out_buf{};
+        std::string typed_ahead{};  // input that arrived while waiting for a cursor report, read before stdin
+        std::deque<int> pending_keys{};
+        bool cursor_visible{true};
+
+        // the terminal's own mode, put back on the way out
+        static inline termios saved_mode{};
+        static inline bool raw_mode{};
+
+        // no line buffering and no echo for the whole session, so keys typed between reads are not
+        // echoed over the frame and input bytes arrive one by one
+        static void enter_raw_mode() {
+            if (raw_mode || tcgetattr(STDIN_FILENO, &saved_mode) != 0) return;
+            termios raw = saved_mode;
+            raw.c_lflag &= ~(ICANON | ECHO);
+            raw.c_iflag &= ~(ICRNL | IXON);
+            raw.c_cc[VMIN] = 1, raw.c_cc[VTIME] = 0;
+            raw_mode = tcsetattr(STDIN_FILENO, TCSANOW, &raw) == 0;
+        }
+
+        static void leave_raw_mode() {
+            if (std::exchange(raw_mode, false)) tcsetattr(STDIN_FILENO, TCSANOW, &saved_mode);
+        }
+
+        // saving is not async-signal-safe, the handler only raises a flag; the key loop sees it
+        // (a pending poll returns early) and closes from there
+        static void on_signal(int) { hung_up = 1; }
+
+        [[noreturn]] void close_now() {
+            flush();
+            leave_raw_mode();
+            if (close_callback != nullptr) std::exchange(close_callback, nullptr)();
+            std::exit(0);
+        }
+
+        // timeout_ms < 0 waits forever
+        [[nodiscard]] static std::optional<uint8_t> poll_byte(int timeout_ms) {
+            pollfd in{STDIN_FILENO, POLLIN, 0};
+            uint8_t byte{};
+            if (poll(&in, 1, timeout_ms) <= 0 || ::read(STDIN_FILENO, &byte, 1) != 1)
+                return std::nullopt;
+            return byte;
+        }
+
+        [[nodiscard]] std::optional<uint8_t> read_byte(int timeout_ms) {
+            if (typed_ahead.empty()) return poll_byte(timeout_ms);
+            const auto BYTE = uint8_t(typed_ahead.front());
+            typed_ahead.erase(0, 1);
+            return BYTE;
+        }
+
+        // ESC [ row ; col R ending the bytes, the answer to a cursor position request
+        [[nodiscard]] static std::optional<SZ<int16_t>> cursor_report(std::string_view bytes) {
+            const size_t START = bytes.rfind("\x1B[");
+            if (START == std::string_view::npos || !bytes.ends_with('R')) return std::nullopt;
+            const char* const END = bytes.data() + bytes.size() - 1;
+            int row{}, col{};
+            auto&& [after_row, row_err] = std::from_chars(bytes.data() + START + 2, END, row);
+            if (row_err != std::errc{} || after_row == END || *after_row != ';') return std::nullopt;
+            auto&& [after_col, col_err] = std::from_chars(after_row + 1, END, col);
+            if (col_err != std::errc{} || after_col != END) return std::nullopt;
+            return SZ<int16_t>{int16_t(col - 1), int16_t(row - 1)};
+        }
+
+        // what _getch returns for a key that has no character: a prefix (0 or 224), then the scan code
+        struct Extended_key {
+            int prefix, scan_code;
+        };
+
+        // ESC [ number ~, ESC [ letter and ESC O letter as xterm and the Linux console send them; the
+        // number is the first parameter, modifiers after ';' are ignored
+        [[nodiscard]] static std::optional<Extended_key> decode_sequence(int number, uint8_t final_byte) {
+            switch (final_byte) {
+                case 'A': return Extended_key{224, 72};
+                case 'B': return Extended_key{224, 80};
+                case 'C': return Extended_key{224, 77};
+                case 'D': return Extended_key{224, 75};
+                case 'H': return Extended_key{224, 71};  // Home
+                case 'F': return Extended_key{224, 79};  // End
+                case 'P': case 'Q': case 'R': case 'S': return Extended_key{0, 59 + final_byte - 'P'};  // F1..F4
+                case '~': break;
+                default: return std::nullopt;
+            }
+            switch (number) {
+                case 1: case 7: return Extended_key{224, 71};
+                case 4: case 8: return Extended_key{224, 79};
+                case 2: return Extended_key{224, 82};  // Insert
+                case 3: return Extended_key{224, 83};  // Delete
+                case 5: return Extended_key{224, 73};  // PgUp
+                case 6: return Extended_key{224, 81};  // PgDn
+                case 11: case 12: case 13: case 14: case 15: return Extended_key{0, 59 + number - 11};  // F1..F5
+                case 17: case 18: case 19: case 20: case 21: return Extended_key{0, 64 + number - 17};  // F6..F10
+                case 23: case 24: return Extended_key{224, 133 + number - 23};  // F11, F12
+                default: return std::nullopt;
+            }
+        }
+
+        // a lone ESC is 27, a known key sequence is its prefix with the scan code queued behind it;
+        // Alt+key and sequences no key maps to give nullopt and are dropped whole, a bare 0 would make
+        // the caller wait for a scan code that never comes
+        [[nodiscard]] std::optional<int> read_escape() {
+            auto&& intro = read_byte(ESCAPE_TIMEOUT_MS);
+            if (!intro) return 27;
+            if (*intro == 27) {  // ESC pressed twice, the second one starts over
+                typed_ahead.insert(0, 1, '\x1B');
+                return 27;
+            }
+            if (*intro != '[' && *intro != 'O') return std::nullopt;
+            int number = 0;
+            bool in_first = true;
+            auto&& final_byte = read_byte(ESCAPE_TIMEOUT_MS);
+            if (*intro == '[' && final_byte == '[') {  // Linux console F1..F5: ESC [ [ A..E
+                final_byte = read_byte(ESCAPE_TIMEOUT_MS);
+                if (!final_byte || *final_byte < 'A' || *final_byte > 'E') return std::nullopt;
+                pending_keys.push_back(59 + *final_byte - 'A');
+                return 0;
+            }
+            for (; final_byte && (*final_byte < 0x40 || *final_byte > 0x7E); final_byte = read_byte(ESCAPE_TIMEOUT_MS)) {
+                if (*final_byte == ';') in_first = false;
+                else if (in_first && *final_byte >= '0' && *final_byte <= '9') number = number * 10 + (*final_byte - '0');
+            }
+            if (!final_byte) return std::nullopt;
+            auto&& key = decode_sequence(number, *final_byte);
+            if (!key) return std::nullopt;
+            pending_keys.push_back(key->scan_code);
+            return key->prefix;
+        }
+
+       public:
+        Posix_terminal() { enter_raw_mode(); }
+
+        ~Posix_terminal() override {
+            if (!cursor_visible) write("\x1B[?25h");
+            flush();
+            leave_raw_mode();
+        }
+
+        void write(std::string_view bytes) override { out_buf += bytes; }
+
+        // one write(2) for everything buffered so far
+        void flush() override {
+            if (out_buf.empty()) return;
+            std::fflush(stdout);  // whatever went through stdio comes first
+            for (size_t done = 0; done < out_buf.size();) {
+                const ssize_t N = ::write(STDOUT_FILENO, out_buf.data() + done, out_buf.size() - done);
+                if (N <= 0) break;
+                done += size_t(N);
+            }
+            out_buf.clear();
+        }
+
+        [[nodiscard]] int read_key() override {
+            if (!pending_keys.empty()) {
+                const int KEY = pending_keys.front();
+                pending_keys.pop_front();
+                return KEY;
+            }
+            flush();
+            std::optional<int> key;
+            while (!key && !hung_up) {
+                switch (const auto BYTE = read_byte(-1).value_or(27)) {
+                    case 27: key = read_escape(); break;  // a dropped sequence reads on
+                    case 127: key = 8; break;  // backspace
+                    case '\n': key = 13; break;
+                    default: key = BYTE; break;
+                }
+            }
+            if (hung_up) close_now();
+            return key.value_or(27);
+        }
+
+        [[nodiscard]] SZ<int16_t> size() override {
+            winsize ws{};
+            if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) != 0 || ws.ws_col == 0)
+                return {int16_t(80), int16_t(24)};
+            return {int16_t(ws.ws_col), int16_t(ws.ws_row)};
+        }
+
+        // asks the terminal itself (DSR), the answer is ESC [ row ; col R; keys typed ahead of the
+        // answer are kept for read_key
+        [[nodiscard]] SZ<int16_t> cursor() override {
+            write("\x1B[6n");
+            flush();
+            std::string received;
+            for (auto&& byte = poll_byte(100); byte; byte = poll_byte(100)) {
+                received += char(*byte);
+                if (auto&& position = cursor_report(received)) {
+                    typed_ahead += received.substr(0, received.rfind("\x1B["));
+                    return *position;
+                }
+            }
+            typed_ahead += received;
+            return {};
+        }
+
+        void resize(const SZ<int16_t>& chars) override {
+            write(std::format("\x1B[8;{};{}t", chars.height, chars.width));  // xterm window op, ignored where unsupported
+            flush();
+        }
+
+        void set_title(std::string_view title) override {
+            write(std::format("\x1B]0;{}\x07", title));
+            flush();
+        }
+
+        void toggle_cursor() override {
+            cursor_visible = !cursor_visible;
+            write(cursor_visible ? "\x1B[?25h" : "\x1B[?25l");
+            flush();
+        }
+
+        void on_close(void (*callback)()) override {
+            close_callback = callback;
+            struct sigaction action{};
+            action.sa_handler = on_signal;  // no SA_RESTART, a blocked read wakes up
+            sigemptyset(&action.sa_mask);
+            sigaction(SIGHUP, &action, nullptr);
+            sigaction(SIGTERM, &action, nullptr);
+        }
+    };
+}  // namespace Console
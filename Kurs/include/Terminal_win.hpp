@@ -0,0 +1,105 @@
+#pragma once
+#define NOMINMAX
+#include <Windows.h>
+#include <conio.h>
+
+#include <cstdio>
+#include <string>
+
+#include "Terminal.hpp"
+
+namespace Console {
+    class Win_terminal : public ITerminal {
+       private:
+        static inline void (*close_callback)() = nullptr;
+        HANDLE out_handle = GetStdHandle(STD_OUTPUT_HANDLE);
+        std::string out_buf{};
+
+        static BOOL WINAPI on_ctrl_event(DWORD reason) {
+            if (reason != CTRL_CLOSE_EVENT || close_callback == nullptr) return FALSE;
+            close_callback();
+            return TRUE;
+        }
+
+        [[nodiscard]] CONSOLE_SCREEN_BUFFER_INFO buffer_info() const {
+            CONSOLE_SCREEN_BUFFER_INFO csbi{};
+            GetConsoleScreenBufferInfo(out_handle, &csbi);
+            return csbi;
+        }
+
+       public:
+        Win_terminal() {
+            SetConsoleCP(65001);
+            SetConsoleOutputCP(65001);
+            DWORD m{};
+            GetConsoleMode(out_handle, &m);
+            SetConsoleMode(out_handle, m | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+        }
+
+        ~Win_terminal() override { flush(); }
+
+        void write(std::string_view bytes) override { out_buf += bytes; }
+
+        void flush() override {
+            if (out_buf.empty()) return;
+            std::fflush(stdout);  // whatever went through stdio comes first
+            DWORD written{};
+            WriteFile(out_handle, out_buf.data(), DWORD(out_buf.size()), &written, NULL);
+            out_buf.clear();
+        }
+
+        [[nodiscard]] int read_key() override {
+            flush();
+            return _getch();
+        }
+
+        [[nodiscard]] SZ<int16_t> size() override {
+            const auto CSBI = buffer_info();
+            return {int16_t(CSBI.srWindow.Right - CSBI.srWindow.Left + 1), int16_t(CSBI.srWindow.Bottom - CSBI.srWindow.Top + 1)};
+        }
+
+        [[nodiscard]] SZ<int16_t> cursor() override {
+            flush();
+            const auto& [X, Y] = buffer_info().dwCursorPosition;
+            return {X, Y};
+        }
+
+        void resize(const SZ<int16_t>& chars) override {
+            flush();
+            auto&& [w, h] = chars;
+            SMALL_RECT rect{0, 0, int16_t(w - 1), int16_t(h - 1)};
+            SetConsoleScreenBufferSize(out_handle, COORD{w, h});
+            SetConsoleWindowInfo(out_handle, TRUE, &rect);
+        }
+
+        void set_title(std::string_view title) override {
+            SetConsoleTitle(std::wstring{title.begin(), title.end()}.c_str());
+        }
+
+        void toggle_cursor() override {
+            CONSOLE_CURSOR_INFO cci;
+            GetConsoleCursorInfo(out_handle, &cci);
+            cci.bVisible = !cci.bVisible;
+            SetConsoleCursorInfo(out_handle, &cci);
+        }
+
+        void on_close(void (*callback)()) override {
+            close_callback = callback;
+            SetConsoleCtrlHandler(on_ctrl_event, true);
+        }
+
+        void set_font(int16_t font_size, const wchar_t* font) override {
+            auto cfi = CONSOLE_FONT_INFOEX{.cbSize = sizeof(CONSOLE_FONT_INFOEX)};
+            GetCurrentConsoleFontEx(out_handle, NULL, &cfi);
+            swprintf_s(cfi.FaceName, font);
+            cfi.dwFontSize.Y = font_size;
+            SetCurrentConsoleFontEx(out_handle, NULL, &cfi);
+        }
+
+        void set_pixel_size(const SZ<uint16_t>& pixels) override {
+            RECT rect{};
+            GetWindowRect(GetConsoleWindow(), &rect);
+            MoveWindow(GetConsoleWindow(), rect.left, rect.top, pixels.width, pixels.height, TRUE);
+        }
+    };
+}  // namespace Console
@@ -1,17 +1,22 @@
 #pragma once
 #include <format>
-#include <iostream>
 #include <memory>
+#include <optional>
 #include <print>
 #include <ranges>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
 #include "Book.hpp"
 #include "Console_wrapper.hpp"
 #include "Fsystem.hpp"
+#include "History.hpp"
+#include "Loans.hpp"
 #include "Log.hpp"
+#include "Row_cache.hpp"
 #include "thirdparty/json.hpp"
 
 enum User_role : uint16_t {
@@ -19,24 +24,132 @@ enum User_role : uint16_t {
     user
 };
 
+struct Account_row {
+    std::string login;
+    size_t password_hash;
+    User_role role;
+};
+
 class User {
    private:
     static inline size_t next_user_id = 1;
     static inline nlohmann::json users_json{};
     static inline std::unique_ptr<User> current_global_user;
+    static inline std::string accounts_file{};
+    static inline std::unordered_map<size_t, std::string> logins_by_id{};
+    static inline std::unordered_set<size_t> stale_loans{};  // users whose "Taken books" lag behind the ledger
+
+    static bool lend(size_t reader_id, Book& book) {
+        if (Loan_ledger::holds(reader_id, book.get_id()) || !book.lend())
+            return false;
+        Loan_ledger::take(reader_id, book.get_id());
+        book.set_last_reader(reader_id);
+        book.count_borrow();
+        book.update_data();
+        Loan_history::append(reader_id, book.get_id(), Loan_event::taken);
+        stale_loans.insert(reader_id);
+        return true;
+    }
+
+    // the returned copy goes straight to the first reader in the book's queue, returns who got it
+    static std::optional<size_t> give_back(size_t reader_id, Book& book) {
+        if (!Loan_ledger::give_back(reader_id, book.get_id()))
+            return std::nullopt;
+        book.restock();
+        book.update_data();
+        Loan_history::append(reader_id, book.get_id(), Loan_event::returned);
+        stale_loans.insert(reader_id);
+        auto&& served = book.serve_holds();
+        return served.empty() ? std::nullopt : std::optional{served.front()};
+    }
+
+    // "Taken books" is a view of the loan ledger, refreshed lazily for users whose loans changed
+    static void sync_loans() {
+        for (auto&& user_id : stale_loans) {
+            auto&& login = logins_by_id.find(user_id);
+            if (login == logins_by_id.end() || !users_json.contains(login->second))
+                continue;
+            auto& taken_books = users_json[login->second]["Taken books"] = nlohmann::json::array();
+            for (auto&& book_id : Loan_ledger::books_of(user_id))
+                taken_books.push_back(book_id);
+            Row_cache::touch(users_json, user_id);
+        }
+        stale_loans.clear();
+    }
 
    public:
     static void load_accounts(std::string_view filename) {
+        accounts_file = filename;
         FileSystem::load(filename, users_json);
         if (!users_json.empty() && !users_json.is_null()) {
-            for (auto&& [_, data] : users_json.items())
-                next_user_id = std::max(next_user_id, data.at("ID").get<size_t>());
+            for (auto&& [login, data] : users_json.items()) {
+                const auto ID = data.at("ID").get<size_t>();
+                next_user_id = std::max(next_user_id, ID);
+                logins_by_id[ID] = login;
+            }
             next_user_id += 1;
         }
     }
-    [[nodiscard]] static const auto& get_json() { return users_json; }
+
+    static void save_accounts() { FileSystem::save(accounts_file, get_json()); }
+
+    [[nodiscard]] static bool exists(std::string_view login) { return users_json.contains(login); }
+
+    // rows must be validated (unique, new logins) and hashed already; nothing is written to disk,
+    // an import flushes with save_accounts() once all its batches are in
+    static void insert_batch(const std::vector<Account_row>& rows) {
+        for (auto&& row : rows) {
+            const size_t ID = next_user_id++;
+            users_json[row.login] = {{"Role", row.role}, {"Password", row.password_hash}, {"ID", ID}};
+            logins_by_id[ID] = row.login;
+            stale_loans.insert(ID);
+        }
+    }
+
+    // must run after both books and accounts are loaded
+    static void load_loans() {
+        // "Taken books" used to list titles, they are resolved to IDs before the ledger reads them
+        for (auto&& [login, data] : users_json.items()) {
+            if (!data.contains("Taken books"))
+                continue;
+            for (auto&& book : data["Taken books"]) {
+                if (!book.is_string()) continue;
+                if (auto&& book_id = Book::find_taken(book.get_ref<const std::string&>(), data.at("ID").get<size_t>()))
+                    book = *book_id;
+                else
+                    Logger::Warning(std::format("Книга \"{}\" у пользователя {} не найдена в каталоге", book.get<std::string>(), login));
+            }
+        }
+        Loan_ledger::rebuild(users_json);
+        for (auto&& [user_id, _] : logins_by_id)
+            stale_loans.insert(user_id);
+        Book::set_hold_lender(lend);
+    }
+
+    [[nodiscard]] static const auto& get_json() {
+        sync_loans();
+        return users_json;
+    }
+    [[nodiscard]] static std::string login_of(size_t user_id) {
+        auto&& it = logins_by_id.find(user_id);
+        return it == logins_by_id.end() ? "?" : it->second;
+    }
     [[nodiscard]] static auto& get_current_user() { return current_global_user; }
-    static void erase(std::string_view user_login) { users_json.erase(user_login); }
+    // leaves every queue and returns whatever the user still holds first, O(k) in their loans
+    static void erase(std::string_view user_login) {
+        if (!users_json.contains(user_login))
+            return;
+        const auto USER_ID = users_json.at(user_login).at("ID").get<size_t>();
+        for (auto&& book_id : Hold_queues::books_of(USER_ID) | std::ranges::to<std::vector<size_t>>())
+            Hold_queues::cancel(USER_ID, book_id);
+        for (auto&& book_id : Loan_ledger::books_of(USER_ID) | std::ranges::to<std::vector<size_t>>()) {
+            Book book(book_id);
+            give_back(USER_ID, book);
+        }
+        users_json.erase(user_login);
+        logins_by_id.erase(USER_ID);
+        stale_loans.erase(USER_ID);
+    }
     [[nodiscard]] static std::vector<User> get_vector() {
         return users_json.items() |
                std::views::transform([](auto&& json_item) {
@@ -47,17 +160,22 @@ class User {
 
    private:
     User_role user_role;
-    size_t user_id{next_user_id++}, user_encrypted_passw;
+    size_t user_id{next_user_id++}, user_encrypted_passw{};
     std::string user_login, passw_raw_data;
 
+    // every mutator calls this, the record's cached table rows are stale from here on
+    void touch() const { Row_cache::touch(users_json, user_id); }
+
    public:
+    using Key = std::string;
+    static constexpr const char* KEY_COLUMN = "Title";  // the login, see represent_json
+
     User(std::string_view login)
         : user_login{login} {
         const nlohmann::json& CURRENT_USER_DATA = users_json.at(user_login);
         CURRENT_USER_DATA["Role"].get_to(user_role);
         CURRENT_USER_DATA["Password"].get_to(user_encrypted_passw);
         CURRENT_USER_DATA["ID"].get_to(user_id);
-        update_data();
     }
 
     User(std::string_view login, std::string_view passw, User_role ROLE)
@@ -65,6 +183,7 @@ class User {
           user_login{login} {
         set_password(passw);
         update_data();
+        touch();
     }
 
     User(User&& other_user) noexcept
@@ -81,11 +200,13 @@ class User {
     [[nodiscard]] auto get_passw() const { return user_encrypted_passw; }
     [[nodiscard]] auto get_login() const { return user_login; }
 
-    inline void set_role(const auto& new_value) { user_role = new_value; }
-    inline void update_ID(const auto& new_value) { user_id = next_user_id++; }
+    inline void set_role(const auto& new_value) { user_role = new_value, touch(); }
+    inline void update_ID(const auto& new_value) { user_id = next_user_id++, touch(); }
+    // the same password again (a login, for one) leaves the record as it was
     inline void set_password(const auto& new_value) {
         passw_raw_data = new_value;
-        user_encrypted_passw = encrypt_str(passw_raw_data, user_login.length());
+        const size_t HASH = encrypt_str(passw_raw_data, user_login.length());
+        if (std::exchange(user_encrypted_passw, HASH) != HASH) touch();
     }
 
     inline void set_login(const auto& new_value) {
@@ -93,6 +214,7 @@ class User {
         user_login = new_value;
         set_password(passw_raw_data);  // rehash current passw after login change
         update_data();
+        touch();
     }
 
     [[nodiscard]] auto get_data() const {
@@ -100,7 +222,8 @@ class User {
             std::format("Логин: {}", user_login),
             std::format("Хеш пароля: {}", user_encrypted_passw),
             std::format("Статус: {}", (user_role == User_role::admin ? "админ" : "пользователь")),
-            std::format("Взято книг: {}", users_json[user_login]["Taken books"].size()),
+            std::format("Взято книг: {}", Loan_ledger::books_of(user_id).size()),
+            std::format("Забронировано книг: {}", Hold_queues::books_of(user_id).size()),
         };
     }
 
@@ -109,32 +232,31 @@ class User {
         j["Role"] = user_role;
         j["Password"] = user_encrypted_passw;
         j["ID"] = user_id;
+        logins_by_id[user_id] = user_login;
+        stale_loans.insert(user_id);
     }
 
-    void take_book(Book& book) const {
-        users_json[user_login]["Taken books"] += book.get_title();
+    // false if no copy is left or the user already holds one
+    bool take_book(Book& book) const { return lend(user_id, book); }
+
+    // returns the reader the copy was handed to, if anyone was waiting
+    std::optional<size_t> return_book(Book& book) const { return give_back(user_id, book); }
+
+    // only books with no copy left can be reserved, and not by someone holding one
+    bool reserve(const Book& book) const {
+        if (book.get_available() > 0 || Loan_ledger::holds(user_id, book.get_id()))
+            return false;
+        return Hold_queues::enqueue(user_id, book.get_id());
     }
 
-    void return_book(Book& book) {
-        auto&& title = book.get_title();
-        auto& taken_books = users_json[user_login]["Taken books"];
-        for (auto&& it = taken_books.begin(); it != taken_books.end(); ++it) {
-            if (it->get<std::string>() == title) {
-                taken_books.erase(it);
-                break;
-            }
-        }
+    bool cancel_reservation(size_t book_id) const { return Hold_queues::cancel(user_id, book_id); }
+
+    [[nodiscard]] std::vector<size_t> get_reserved_ids() const {
+        return Hold_queues::books_of(user_id) | std::ranges::to<std::vector<size_t>>();
     }
 
-    [[nodiscard]] std::vector<std::string> get_taken_books() const {
-        auto&& taken_books = users_json[user_login]["Taken books"];
-        if (taken_books.empty() || taken_books.is_null())
-            return {};
-        return taken_books |
-               std::views::transform([](auto&& book_title_js) {
-                   return book_title_js.get<std::string>();
-               }) |
-               std::ranges::to<std::vector<std::string>>();
+    [[nodiscard]] std::vector<size_t> get_taken_ids() const {
+        return Loan_ledger::books_of(user_id) | std::ranges::to<std::vector<size_t>>();
     }
 };
 
@@ -147,7 +269,7 @@ namespace AUTHORIZATION_FORMS {
         const auto LOGIN_BUF = Console_wrapper::get_inline_input<std::string>();
         if (!ALL_ACCS.contains(LOGIN_BUF)) {
             Logger::Error("Аккаунта с таким логином не существует");
-            std::cin.get();
+            (void)Console::readKey();
             return login_form();
         }
         const size_t USER_PASSW = ALL_ACCS[LOGIN_BUF].at("Password").get<std::size_t>();
@@ -156,7 +278,7 @@ namespace AUTHORIZATION_FORMS {
         const auto PASSW_BUF = Console_wrapper::get_inline_input<std::string>(true);
         if (USER_PASSW != encrypt_str(PASSW_BUF, LOGIN_BUF.length())) {
             Logger::Error("Неверный пароль");
-            std::cin.get();
+            (void)Console::readKey();
             return login_form();
         }
         User::get_current_user() = std::make_unique<User>(LOGIN_BUF);
@@ -172,7 +294,7 @@ namespace AUTHORIZATION_FORMS {
         const auto LOGIN_BUF = Console_wrapper::get_inline_input<std::string>();
         if (ALL_ACCS.contains(LOGIN_BUF)) {
             Logger::Error("Аккаунт с таким логином уже существует");
-            std::cin.get();
+            (void)Console::readKey();
             return registration_form();
         }
 
@@ -183,7 +305,7 @@ namespace AUTHORIZATION_FORMS {
         const auto REP_PASSW_BUF = Console_wrapper::get_inline_input<std::string>(true);
         if (PASSW_BUF != REP_PASSW_BUF) {
             Logger::Error("Пароли не совпадают");
-            std::cin.get();
+            (void)Console::readKey();
             return registration_form();
         }
 
@@ -0,0 +1,186 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define UTF8_SSE2
+#include <emmintrin.h>
+#endif
+
+// display width of UTF-8 text in terminal columns: escape sequences take none, combining marks take none,
+// CJK and emoji take two, everything else one. Truncation never splits a character and returns a view
+namespace Utf8 {
+    constexpr std::string_view ELLIPSIS = "...";
+
+    [[nodiscard]] constexpr size_t sequence_length(char lead) {
+        const auto BYTE = uint8_t(lead);
+        return BYTE >= 0xF0 ? 4 : BYTE >= 0xE0 ? 3 : BYTE >= 0xC0 ? 2 : 1;
+    }
+
+    [[nodiscard]] constexpr bool is_continuation(char byte) { return (uint8_t(byte) & 0xC0) == 0x80; }
+
+    // end of the escape sequence starting at pos: CSI (ESC [ ... final) or a two-byte ESC x
+    [[nodiscard]] constexpr size_t escape_end(std::string_view text, size_t pos) {
+        if (pos + 1 >= text.size()) return text.size();
+        if (text[pos + 1] != '[') return pos + 2;
+        size_t end = pos + 2;
+        while (end < text.size() && (text[end] < 0x40 || text[end] > 0x7E)) ++end;
+        return std::min(end + 1, text.size());
+    }
+
+    [[nodiscard]] constexpr char32_t decode(std::string_view glyph) {
+        if (glyph.empty()) return 0;
+        const size_t LEN = std::min(sequence_length(glyph[0]), glyph.size());
+        constexpr uint8_t LEAD_MASK[] = {0, 0x7F, 0x1F, 0x0F, 0x07};
+        char32_t cp = uint8_t(glyph[0]) & LEAD_MASK[LEN];
+        for (size_t i = 1; i < LEN; i++) cp = (cp << 6) | (uint8_t(glyph[i]) & 0x3F);
+        return cp;
+    }
+
+    [[nodiscard]] constexpr int code_point_width(char32_t cp) {
+        if ((cp >= 0x0300 && cp <= 0x036F) || (cp >= 0x200B && cp <= 0x200F) || (cp >= 0x20D0 && cp <= 0x20FF) ||
+            (cp >= 0xFE00 && cp <= 0xFE0F))
+            return 0;
+        if ((cp >= 0x1100 && cp <= 0x115F) || (cp >= 0x2E80 && cp <= 0xA4CF && cp != 0x303F) || (cp >= 0xAC00 && cp <= 0xD7A3) ||
+            (cp >= 0xF900 && cp <= 0xFAFF) || (cp >= 0xFE30 && cp <= 0xFE4F) || (cp >= 0xFF00 && cp <= 0xFF60) ||
+            (cp >= 0xFFE0 && cp <= 0xFFE6) || (cp >= 0x1F300 && cp <= 0x1F64F) || (cp >= 0x1F900 && cp <= 0x1F9FF) ||
+            (cp >= 0x20000 && cp <= 0x3FFFD))
+            return 2;
+        return 1;
+    }
+
+    namespace detail {
+        constexpr size_t BLOCK = 16;
+
+        // columns of a block made of ASCII and two-byte characters (Latin, Cyrillic, Greek): one per byte
+        // that is not a continuation. -1 when the block holds ESC, a lead of a longer sequence or of a
+        // combining mark (0xCC, 0xCD). Both versions are compiled where SSE2 exists, so they can be
+        // checked against each other
+#ifdef UTF8_SSE2
+        [[nodiscard]] inline int narrow_block_width_sse2(const char* block) {
+            const __m128i V = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block));
+            const int HIGH = _mm_movemask_epi8(V);
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(V, _mm_set1_epi8(0x1B))) != 0) return -1;
+            if (HIGH == 0) return int(BLOCK);
+            if ((_mm_movemask_epi8(_mm_cmpgt_epi8(V, _mm_set1_epi8(int8_t(0xDF)))) & HIGH) != 0) return -1;  // 0xE0..0xFF
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(V, _mm_set1_epi8(int8_t(0xFE))), _mm_set1_epi8(int8_t(0xCC)))) != 0)
+                return -1;
+            const int CONTINUATIONS = _mm_movemask_epi8(_mm_cmplt_epi8(V, _mm_set1_epi8(int8_t(0xC0))));  // 0x80..0xBF
+            return int(BLOCK) - std::popcount(unsigned(CONTINUATIONS));
+        }
+#endif
+
+        // the same on two 64-bit words
+        [[nodiscard]] inline int narrow_block_width_swar(const char* block) {
+            constexpr uint64_t ONES = 0x0101010101010101, HIGHS = 0x8080808080808080;
+            auto&& has_zero_byte = [](uint64_t v) { return ((v - ONES) & ~v & HIGHS) != 0; };
+            int columns = 0;
+            for (size_t half = 0; half < BLOCK; half += 8) {
+                uint64_t w;
+                std::memcpy(&w, block + half, 8);
+                if (has_zero_byte(w ^ (ONES * 0x1B)) || has_zero_byte((w & (ONES * 0xFE)) ^ (ONES * 0xCC))) return -1;
+                if ((w & (w << 1) & (w << 2) & HIGHS) != 0) return -1;  // 111xxxxx leads
+                columns += 8 - std::popcount(w & ~(w << 1) & HIGHS);   // 10xxxxxx continuations
+            }
+            return columns;
+        }
+
+        [[nodiscard]] inline int narrow_block_width(const char* block) {
+#ifdef UTF8_SSE2
+            return narrow_block_width_sse2(block);
+#else
+            return narrow_block_width_swar(block);
+#endif
+        }
+
+        // one character or escape sequence at pos, the slow way; returns where the next one starts
+        [[nodiscard]] constexpr size_t step(std::string_view text, size_t pos, int& columns) {
+            if (text[pos] == '\x1B') {
+                columns = 0;
+                return escape_end(text, pos);
+            }
+            if (is_continuation(text[pos])) {  // tail of a character already counted
+                columns = 0;
+                return pos + 1;
+            }
+            const size_t LEN = std::min(sequence_length(text[pos]), text.size() - pos);
+            columns = LEN == 1 ? 1 : code_point_width(decode(text.substr(pos, LEN)));
+            return pos + LEN;
+        }
+    }  // namespace detail
+
+    [[nodiscard]] inline size_t width(std::string_view text) {
+        size_t columns = 0;
+        for (size_t i = 0; i < text.size();) {
+            if (text.size() - i >= detail::BLOCK) {
+                if (const int W = detail::narrow_block_width(text.data() + i); W >= 0) {
+                    columns += size_t(W), i += detail::BLOCK;
+                    continue;
+                }
+            }
+            int w = 0;
+            i = detail::step(text, i, w);
+            columns += size_t(w);
+        }
+        return columns;
+    }
+
+    // the longest prefix that fits in max_columns; escapes and combining marks stay with what precedes them
+    [[nodiscard]] inline std::string_view truncate(std::string_view text, size_t max_columns) {
+        size_t columns = 0, i = 0;
+        while (i < text.size()) {
+            if (text.size() - i >= detail::BLOCK) {
+                if (const int W = detail::narrow_block_width(text.data() + i); W >= 0 && columns + size_t(W) <= max_columns) {
+                    columns += size_t(W), i += detail::BLOCK;
+                    continue;
+                }
+            }
+            int w = 0;
+            const size_t NEXT = detail::step(text, i, w);
+            if (columns + size_t(w) > max_columns) break;
+            columns += size_t(w), i = NEXT;
+        }
+        return text.substr(0, i);
+    }
+
+    // the longest prefix of at most max_bytes that does not end inside a character, for byte-sized buffers
+    [[nodiscard]] constexpr std::string_view truncate_bytes(std::string_view text, size_t max_bytes) {
+        if (text.size() <= max_bytes) return text;
+        while (max_bytes > 0 && is_continuation(text[max_bytes])) --max_bytes;
+        return text.substr(0, max_bytes);
+    }
+
+    // text cut to max_columns, leaving room for an ellipsis when it had to be cut
+    struct Fit {
+        std::string_view head;
+        bool ellipsis;
+        size_t width;  // head plus the ellipsis
+    };
+
+    [[nodiscard]] inline Fit fit(std::string_view text, size_t max_columns) {
+        if (const size_t W = width(text); W <= max_columns) return {text, false, W};
+        if (max_columns < ELLIPSIS.size()) {
+            const auto HEAD = truncate(text, max_columns);
+            return {HEAD, false, width(HEAD)};
+        }
+        const auto HEAD = truncate(text, max_columns - ELLIPSIS.size());
+        return {HEAD, true, width(HEAD) + ELLIPSIS.size()};
+    }
+
+    // appends the fitted text padded with spaces to `columns`; align is '<', '>' or '^' as in std::format
+    inline void pad(std::string& out, const Fit& fitted, size_t columns, char align = '<') {
+        const size_t SPACES = columns > fitted.width ? columns - fitted.width : 0;
+        const size_t BEFORE = align == '>' ? SPACES : align == '^' ? SPACES / 2 : 0;
+        out.append(BEFORE, ' ').append(fitted.head);
+        if (fitted.ellipsis) out.append(ELLIPSIS);
+        out.append(SPACES - BEFORE, ' ');
+    }
+
+    inline void pad(std::string& out, std::string_view text, size_t columns, char align = '<') {
+        pad(out, Fit{text, false, width(text)}, columns, align);
+    }
+}  // namespace Utf8
@@ -1,45 +1,56 @@
 #pragma once
 #include <algorithm>
+#include <array>
+#include <charconv>
 #include <format>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "thirdparty/json.hpp"
 
-[[nodiscard]] constexpr size_t my_strlen(std::string_view str) {
-    return std::ranges::count_if(str, [](auto&& byte) {
-        return ((byte & 0x80) == 0 || (byte & 0xC0) == 0xC0);
-    });
-}
-
-[[nodiscard]] constexpr std::string cut_str(std::string_view str, size_t count) {
-    const std::string as_str{str};
-    return str.length() < count ? as_str : as_str.substr(0, count - 3) + "...";
-}
-
-[[nodiscard]] constexpr std::string remove_quotes(auto&& str) {
-    return str.front() == '"' ? str.substr(1, str.length() - 2) : str;
-}
-
-[[nodiscard]] constexpr std::string place_by_width(auto&& str, uint16_t width, char pos = '<') {
-    if (width <= str.size()) return str;
-    return std::vformat(std::format("{{: {}{}}}", pos, width), std::make_format_args(str));
-}
-
-[[nodiscard]] constexpr std::string value_view(auto&& value) {
-    return value.is_array() ? std::to_string(value.size()) : remove_quotes(nlohmann::to_string(value));
+using Cell_buf = std::array<char, 32>;
+
+// what a table cell shows for a json value, without allocating: strings are viewed in place,
+// numbers are printed into buf, arrays show their size
+[[nodiscard]] inline std::string_view cell_view(const nlohmann::json& value, Cell_buf& buf) {
+    auto&& print = [&buf](auto number) {
+        return std::string_view(buf.data(), std::to_chars(buf.data(), buf.data() + buf.size(), number).ptr);
+    };
+    using enum nlohmann::json::value_t;
+    switch (value.type()) {
+        case string: return value.get_ref<const std::string&>();
+        case boolean: return value.get<bool>() ? "true" : "false";
+        case number_integer: return print(value.get<int64_t>());
+        case number_unsigned: return print(value.get<uint64_t>());
+        case number_float: return print(value.get<double>());
+        case array: return print(value.size());
+        case null: return "null";
+        default: return "{...}";
+    }
 }
 
 [[nodiscard]] inline std::vector<nlohmann::json> represent_json(const nlohmann::json& json_obj) {
     std::vector<nlohmann::json> json_objects;
     for (auto&& [key, sub_json] : json_obj.items()) {
         nlohmann::json new_obj = sub_json;
-        new_obj["Title"] = key;
+        if (!new_obj.contains("Title")) new_obj["Title"] = key;
         json_objects.emplace_back(new_obj);
     }
     return json_objects;
 }
 
+// same as above, but only for the given keys (e.g. a slice of a secondary index)
+[[nodiscard]] inline std::vector<nlohmann::json> represent_json(const nlohmann::json& json_obj, auto&& keys) {
+    std::vector<nlohmann::json> json_objects;
+    for (auto&& key : keys) {
+        nlohmann::json new_obj = json_obj.at(key);
+        if (!new_obj.contains("Title")) new_obj["Title"] = key;
+        json_objects.emplace_back(std::move(new_obj));
+    }
+    return json_objects;
+}
+
 [[nodiscard]] size_t encrypt_str(std::string_view arg, size_t key) {
     return std::hash<std::string>{}(
         arg |
@@ -1,15 +1,22 @@
-#include <conio.h>
-
+#include <filesystem>
 #include <memory>
 #include <string_view>
+#include <vector>
 constexpr std::string_view users_file = "users.json";
 constexpr std::string_view books_file = "generated_books.json";
+constexpr std::string_view history_file = "loan_history.bin";
+constexpr std::string_view holds_file = "reservations.json";
+constexpr std::string_view log_file = "library.log";
 
 #include "../include/Book.hpp"
 #include "../include/Console_wrapper.hpp"
+#include "../include/Consistency.hpp"
 #include "../include/Fsystem.hpp"
 #include "../include/Library.hpp"
+#include "../include/Loans.hpp"
 #include "../include/Log.hpp"
+#include "../include/Self_check.hpp"
+#include "../include/Session.hpp"
 #include "../include/User.hpp"
 
 // #define GENERATE
@@ -19,39 +26,44 @@ constexpr std::string_view books_file = "generated_books.json";
 int main() {
     static Random r;
     constexpr size_t N = 200;
-    for (size_t i = 0; i < N; i++) {
-        auto&& title = r.generate_string(5, 30);
-        auto&& in_lib = (bool)(r.get(0, 1));
-        auto&& year = r.get(1900, 2023);
-        auto&& pages = r.get(10, 500);
-        auto&& author = r.generate_string(10, 35);
-        auto&& publisher = r.generate_string(4, 15);
-        Book(title, in_lib, year, pages, author, publisher);
+    std::vector<Book_row> rows(N);
+    for (auto& row : rows) {
+        row.title = r.generate_string(5, 30);
+        row.copies = r.get(1, 3);
+        row.year = r.get(1900, 2023);
+        row.pages = r.get(10, 500);
+        row.author = r.generate_string(10, 35);
+        row.publisher = r.generate_string(4, 15);
     }
-    FileSystem::save(books_file, Book::get_json());
+    Book::insert_batch(rows);
+    Book::save_books(books_file);
     Logger::Success(N, "случайно сгенерированных книг было записано в", books_file);
 }
 #else
 
 static void print_copyright() {
-    std::println("Программа разработана БГАС");
-    std::println("ИТ291 Клещинский Александр");
-    std::println("Дата сборки: {}", __DATE__);
-    system("pause");
-    system("cls");
+    Logger::Print("Программа разработана БГАС");
+    Logger::Print("ИТ291 Клещинский Александр");
+    Logger::Print("Дата сборки:", __DATE__);
+    Logger::Warning("Нажмите любую клавишу чтобы продолжить");
+    (void)Console::readKey();
+    Console::clear();
 }
 
-BOOL WINAPI on_exit_callback(DWORD reason) {
-    if (reason == CTRL_CLOSE_EVENT) {
-        FileSystem::save(users_file, User::get_json());
-        FileSystem::save(books_file, Book::get_json());
-        return true;
-    }
+static void on_exit_callback() {
+    User::save_accounts();
+    Book::save_books(books_file);
+    Hold_queues::save();
 }
 
-int main() {
-    SetConsoleCP(65001);
-    SetConsoleOutputCP(65001);
+static void run_library() {
+    Logger::open_file(log_file);
+    Book::load_books(books_file);
+    User::load_accounts(users_file);
+    Loan_history::open(history_file);
+    User::load_loans();
+    Hold_queues::load(holds_file);
+    CONSISTENCY::check_and_repair();
     print_copyright();
 
     const std::string window_title = "lib App";
@@ -59,12 +71,9 @@ int main() {
     Console::configure(window_title, {600, 400});
     Logger::new_line_enabled = false;
 
-    Book::load_books(books_file);
-    User::load_accounts(users_file);
-
     const std::unique_ptr<User>& USER = authorize();
     Console::setTitle(window_title + " | " + USER->get_login());
-    SetConsoleCtrlHandler(on_exit_callback, true);
+    Console::onClose(on_exit_callback);
 
     const std::unique_ptr<ILibrary> lib = USER->is_admin() ? std::make_unique<Admin_lib>() : std::make_unique<User_lib>();
     static const auto& menu = lib->get_menu();
@@ -74,6 +83,63 @@ int main() {
         lib->do_at(selected);
         Console_wrapper::new_line();
         Logger::Warning("Нажмите любую клавишу чтобы продолжить");
-    } while (_getch() != Keys::ESCAPE);
+    } while (Console::readKey() != Keys::ESCAPE);
+    // leaving with ESC saves like closing the window does, so the index file next to the catalog
+    // carries the new catalog stamp and the next start loads it instead of rebuilding
+    on_exit_callback();
+}
+
+// the session runs on a scratch copy of the snapshot, so every replay starts from the same catalog
+static int replay(const std::filesystem::path& session_file, const std::filesystem::path& snapshot) {
+    namespace fs = std::filesystem;
+    auto&& recording = Session::load(session_file);
+    if (!recording) {
+        Logger::Error("Не удалось прочитать сессию", session_file.string());
+        return 1;
+    }
+    std::error_code ec;
+    const auto WORK_DIR = fs::temp_directory_path(ec) / "lib_replay";
+    fs::remove_all(WORK_DIR, ec);
+    fs::copy(snapshot, WORK_DIR, fs::copy_options::recursive, ec);
+    if (ec) {
+        Logger::Error("Не удалось скопировать снимок каталога", snapshot.string());
+        return 1;
+    }
+    fs::current_path(WORK_DIR);
+
+    auto&& [W, H] = recording->size;
+    auto timing = std::make_unique<Session::Timing_terminal>(W, H, std::move(recording->keys));
+    const auto& TIMING = *timing;
+    auto console = Console::setTerminal(std::move(timing));
+    try {
+        run_library();
+    } catch (const Console::Keys_exhausted&) {
+        // the recording ended mid-session
+    }
+    const auto REPLAYED = Console::setTerminal(std::move(console));
+    Logger::new_line_enabled = true;
+    Logger::Print(Session::make_report(TIMING).to_string());
+    return 0;
+}
+
+static int check() {
+    auto&& failures = SELF_CHECK::run_all();
+    for (auto&& failure : failures) Logger::Error(failure);
+    if (failures.empty()) Logger::Success("Все проверки пройдены");
+    return failures.empty() ? 0 : 1;
+}
+
+// --record <session>              run as usual, every key read is also written to the session file
+// --replay <session> <snapshot>   run the session headlessly against a catalog snapshot directory, print keystroke latencies
+// --check                         run the self-checks that need no catalog, exit code 1 if any fails
+int main(int argc, char* argv[]) {
+    const std::vector<std::string_view> ARGS(argv + 1, argv + argc);
+    if (!ARGS.empty() && ARGS[0] == "--check")
+        return check();
+    if (ARGS.size() >= 3 && ARGS[0] == "--replay")
+        return replay(std::filesystem::absolute(ARGS[1]), std::filesystem::absolute(ARGS[2]));
+    if (ARGS.size() >= 2 && ARGS[0] == "--record")
+        Console::terminal = std::make_unique<Session::Recording_terminal>(std::move(Console::terminal), ARGS[1]);
+    run_library();
 }
 #endif
\ No newline at end of file